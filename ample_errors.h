@@ -6,6 +6,7 @@ typedef enum AmpleErrorCode {
   ERROR_UNSUPPORTED_OPERATION,
   ERROR_OPERATION_ON_DIFFERENT_TYPES,
   ERROR_INVALID_OBJECT_TYPE,
+  ERROR_STACK_OVERFLOW,
 } AmpleErrorCode;
 
 const char *ample_error_codes[] = {
@@ -15,5 +16,6 @@ argument(s) and %u were provided\n",
   "ERROR: Unsupported operation for variable of type %s operating on type %s\n",
   "ERROR: Cannot perform operation of differing types: %s and %s\n",
   "ERROR: Invalid object of type %s\n",
+  "ERROR: Stack overflow, the calls being run need more than %u MB\n",
 };
 #endif
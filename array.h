@@ -63,6 +63,9 @@ struct Array_Buffer {
     arr_ptr[buff->count++] = item;                                             \
   }
 
+/* removes the last item, the array must not be empty */
+#define ARRAY_POP(arr_ptr) (ARR_BASE_POINTER(arr_ptr)->count--)
+
 static size_t ARRAY_COUNT(void *arr)
 {
   if (arr)
@@ -17,45 +17,175 @@
 
 #include "array.h"
 #include "ast.h"
-static struct AST *ast_buffer;
-size_t
-ast_get_node_handle ()
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/* the node sizes are multiples of the alignment of struct AST,
+ * the last pool holds the kinds that fit nowhere else */
+static struct ASTPool ast_pools[AST_POOL_COUNT] = {
+  { NULL, 0, 16 },
+  { NULL, 0, 24 },
+  { NULL, 0, sizeof (struct AST) },
+};
+static bool32 ast_pools_borrowed;
+
+/* the strings of the tree are packed into blocks that are
+ * freed together with it */
+#define AST_STRING_BLOCK_SIZE 4096
+struct ASTStringBlock {
+  struct ASTStringBlock *next;
+  size_t used;
+  size_t size;
+  char data[1];
+};
+static struct ASTStringBlock *ast_strings;
+
+char *
+ast_copy_string (const char *str, size_t length)
 {
-  struct AST a = { 0 };
-  ARRAY_PUSH (ast_buffer, a);
-  return ARRAY_COUNT (ast_buffer);
+  struct ASTStringBlock *block = ast_strings;
+  char *copy;
+  if (!block || block->used + length + 1 > block->size)
+    {
+      size_t size = length + 1 > AST_STRING_BLOCK_SIZE
+                      ? length + 1 : AST_STRING_BLOCK_SIZE;
+      block = malloc (offsetof (struct ASTStringBlock, data) + size);
+      block->next = ast_strings;
+      block->used = 0;
+      block->size = size;
+      ast_strings = block;
+    }
+  copy = block->data + block->used;
+  memcpy (copy, str, length);
+  copy[length] = '\0';
+  block->used += length + 1;
+  return copy;
+}
+ASTHandle
+ast_new_node (enum ASTType type)
+{
+  unsigned int pool_index = ast_pool_for_type (type);
+  struct ASTPool *pool = &ast_pools[pool_index];
+  struct AST *node;
+  if (pool->count >= AST_MAX_POOL_NODES)
+    {
+      printf ("Too many syntax tree nodes\n");
+      exit (1);
+    }
+  if (pool->count / AST_POOL_CHUNK_NODES == ARRAY_COUNT (pool->chunks))
+    {
+      char *chunk = calloc (AST_POOL_CHUNK_NODES, pool->node_size);
+      ARRAY_PUSH (pool->chunks, chunk);
+    }
+  node = ast_pool_node (pool, pool->count);
+  node->type = type;
+  pool->count++;
+  return (pool->count << AST_HANDLE_POOL_BITS) | pool_index;
 }
+
 struct AST *
-ast_get_node (ASTHandle index)
+ast_get_node (ASTHandle handle)
 {
-  if (index == 0)
+  if (handle == 0)
     return NULL;
-  else
-    return &ast_buffer[index-1];
+  return ast_pool_node (&ast_pools[handle & AST_HANDLE_POOL_MASK],
+                        (handle >> AST_HANDLE_POOL_BITS) - 1);
+}
+
+size_t
+ast_node_size (enum ASTType type)
+{
+#define X(type, data) offsetof (struct AST, d) + sizeof (data),
+  static const size_t sizes[] = { AST_TYPES };
+#undef X
+  return sizes[type];
+}
+
+unsigned int
+ast_pool_for_type (enum ASTType type)
+{
+  size_t size = ast_node_size (type);
+  unsigned int i;
+  for (i = 0; i < AST_POOL_COUNT - 1; i++)
+    {
+      if (size <= ast_pools[i].node_size)
+        return i;
+    }
+  /* the last pool fits every kind */
+  return AST_POOL_COUNT - 1;
 }
+
+struct AST *
+ast_pool_node (struct ASTPool *pool, unsigned int index)
+{
+  return (struct AST *) (pool->chunks[index / AST_POOL_CHUNK_NODES]
+                         + (index % AST_POOL_CHUNK_NODES) * pool->node_size);
+}
+
+struct ASTPool *
+ast_get_pools (void)
+{
+  return ast_pools;
+}
+
+void
+ast_borrow_pools (struct ASTPool *pools)
+{
+  unsigned int i;
+  ast_free_buffer ();
+  for (i = 0; i < AST_POOL_COUNT; i++)
+    {
+      ast_pools[i].chunks = pools[i].chunks;
+      ast_pools[i].count = pools[i].count;
+    }
+  ast_pools_borrowed = true;
+}
+
 void
 ast_free_buffer ()
 {
-  size_t i = 0;
-  size_t count = ARRAY_COUNT (ast_buffer);
-  for (i = 0; i < count; i++)
+  unsigned int p;
+  for (p = 0; p < AST_POOL_COUNT; p++)
     {
-      if (ast_buffer[i].type == AST_SCOPE)
-        {
-          ARRAY_FREE (ast_buffer[i].d.scope_data.statements);
-        }
-      if (ast_buffer[i].type == AST_FUNC)
-        {
-          ARRAY_FREE (ast_buffer[i].d.func_data.args);
-        }
-      if (ast_buffer[i].type == AST_FUNC_CALL)
+      struct ASTPool *pool = &ast_pools[p];
+      unsigned int i;
+      for (i = 0; i < pool->count && !ast_pools_borrowed; i++)
         {
-          ARRAY_FREE (ast_buffer[i].d.func_call_data.args);
+          struct AST *node = ast_pool_node (pool, i);
+          switch (node->type)
+            {
+            case AST_SCOPE:
+              ARRAY_FREE (node->d.scope_data.statements);
+              ARRAY_FREE (node->d.scope_data.locals);
+              break;
+            case AST_FUNC:
+              ARRAY_FREE (node->d.func_data.args);
+              ARRAY_FREE (node->d.func_data.locals);
+              break;
+            case AST_FUNC_CALL:
+              ARRAY_FREE (node->d.func_call_data.args);
+              break;
+            case AST_LIST:
+              ARRAY_FREE (node->d.list_data.items);
+              break;
+            default:
+              break;
+            }
         }
-      if (ast_buffer[i].type == AST_LIST)
+      for (i = 0; i < ARRAY_COUNT (pool->chunks) && !ast_pools_borrowed; i++)
         {
-          ARRAY_FREE (ast_buffer[i].d.list_data.items);
+          free (pool->chunks[i]);
         }
+      ARRAY_FREE (pool->chunks);
+      pool->chunks = NULL;
+      pool->count = 0;
+    }
+  ast_pools_borrowed = false;
+  while (ast_strings)
+    {
+      struct ASTStringBlock *next = ast_strings->next;
+      free (ast_strings);
+      ast_strings = next;
     }
-  ARRAY_FREE (ast_buffer);
 }
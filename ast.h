@@ -18,30 +18,50 @@
 #define AST_H_
 #include "lexer.h"
 #include "bool.h"
-#include "dict_vars.h"
-typedef size_t ASTHandle;
+#include "symbol.h"
+#include <stdint.h>
+/* 0 is no node. The low bits pick the pool the node is in,
+ * the rest are its index in the pool plus one */
+typedef uint32_t ASTHandle;
+/* every kind of node with the struct holding its data */
+#define AST_TYPES                                                              \
+  X(AST_INTEGER, struct IntegerAST)                                            \
+  X(AST_STRING, struct StringAST)                                              \
+  X(AST_IDENTIFIER, struct IdentifierAST)                                      \
+  X(AST_SCOPE, struct ScopeAST)                                                \
+  X(AST_BINARY_OP, struct BinaryOpAST)                                         \
+  X(AST_ASSIGNMENT, struct AssignmentAST)                                      \
+  X(AST_IF, struct IfAST)                                                      \
+  X(AST_BOOL, struct BoolAST)                                                  \
+  X(AST_BINARY_COMPARATOR, struct BinaryComparatorAST)                         \
+  X(AST_FUNC, struct FuncAST)                                                  \
+  X(AST_FUNC_CALL, struct FuncCallAST)                                         \
+  X(AST_LIST, struct ListAST)                                                  \
+  X(AST_WHILE, struct WhileAST)                                                \
+  X(AST_FOR, struct ForAST)
+#define X(type, data) type,
 enum ASTType {
-  AST_INTEGER,
-  AST_STRING,
-  AST_IDENTIFIER,
-  AST_SCOPE,
-  AST_BINARY_OP,
-  AST_ASSIGNMENT,
-  AST_IF,
-  AST_BOOL,
-  AST_BINARY_COMPARATOR,
-  AST_FUNC,
-  AST_FUNC_CALL,
-  AST_OP,
-  AST_PAREN,
-  AST_LIST,
+  AST_TYPES
 };
+#undef X
 /* declare here so sub-ast types can have pointers to the general struct */
 struct AST;
 
+/* where a variable is stored, filled in by the resolver.
+ * globals are indexed by slot alone, locals are found by walking
+ * "depth" scopes out from the scope the variable is used in */
+struct VarLocation {
+  bool32 global;
+  unsigned int depth;
+  unsigned int slot;
+};
+
 struct ScopeAST {
   ASTHandle *statements; /* sb array */
-  DICT(ObjVars) *variable_scope_stack;
+  Symbol *locals; /* sb array, names bound in this scope by slot */
+  /* false when the scope binds no names, it then runs in the frame
+   * of the scope around it and isn't counted in VarLocation.depth */
+  bool32 has_frame;
 };
 
 struct IntegerAST {
@@ -53,7 +73,8 @@ struct StringAST {
 };
 
 struct IdentifierAST {
-  char *id; /* ssl string */
+  Symbol id;
+  struct VarLocation loc;
 };
 struct BinaryOpAST {
   ASTHandle left;
@@ -61,8 +82,9 @@ struct BinaryOpAST {
   TValue op;
 };
 struct AssignmentAST {
-  char *var;
+  Symbol var;
   ASTHandle expr;
+  struct VarLocation loc;
 };
 struct IfAST {
   ASTHandle expr;
@@ -86,23 +108,48 @@ struct BinaryComparatorAST {
   BinaryOpBoolType type;
 };
 struct FuncAST {
-  const char *name;
   ASTHandle *args;
+  /* sb array, the arguments followed by every name bound
+   * at the top level of the function's scope */
+  Symbol *locals;
+  Symbol name;
   ASTHandle scope;
 };
+/* how a call is the last thing its function does, a user defined
+ * function called like this runs in the frame of the caller */
+typedef enum {
+  CALL_TAIL_NONE,
+  CALL_TAIL_STATEMENT, /* the last statement, the caller returns nothing */
+  CALL_TAIL_RETURN,    /* return (call), its value is the caller's */
+} CallTail;
+
 struct FuncCallAST {
-  const char *name;
   ASTHandle *args;
-};
-struct OpAST {
-  char op;
-};
-struct ParenAST {
-  char val;
+  Symbol name;
+  /* the AmpleBuiltinId of the name, it's used if
+   * no user defined function has the name */
+  unsigned short builtin;
+  unsigned short tail; /* CallTail, set by the optimizer */
+  /* what the name meant the last time the call ran, only
+   * good while generation is the interpreter's generation */
+  ASTHandle cached_func; /* 0 if there is none */
+  unsigned int generation;
 };
 struct ListAST {
   ASTHandle *items;
 };
+struct WhileAST {
+  ASTHandle expr;
+  ASTHandle scope; /* 0 for an empty body */
+};
+/* for (init; expr; step) scope. init and step are statements that run
+ * in the scope around the loop, either can be 0 */
+struct ForAST {
+  ASTHandle init;
+  ASTHandle expr;
+  ASTHandle step;
+  ASTHandle scope;
+};
 struct AST {
   enum ASTType type;
   union data {
@@ -117,15 +164,47 @@ struct AST {
     struct BinaryComparatorAST bcmp_data;
     struct FuncAST func_data;
     struct FuncCallAST func_call_data;
-    struct OpAST op_data;
-    struct ParenAST paren_data;
     struct ListAST list_data;
+    struct WhileAST while_data;
+    struct ForAST for_data;
   } d;
 };
 
-size_t ast_get_node_handle();
-struct AST *ast_get_node(ASTHandle index);
+/* returns a zeroed node of the given type. Nodes never move, so
+ * pointers to them stay good while more nodes are made */
+ASTHandle ast_new_node(enum ASTType type);
+struct AST *ast_get_node(ASTHandle handle);
+
+/* returns a NUL terminated copy of str that lives as long as the tree */
+char *ast_copy_string(const char *str, size_t length);
 
 /* call this AFTER the ast is done being used */
 void ast_free_buffer();
+
+/* ******************
+   Internal Functions
+   ****************** */
+/* A node only takes the bytes its kind needs, kinds are grouped into
+ * pools of a few node sizes. A pool hands out nodes from chunks of
+ * AST_POOL_CHUNK_NODES nodes that are only freed with the tree */
+#define AST_POOL_COUNT 3
+#define AST_POOL_CHUNK_NODES 256
+#define AST_HANDLE_POOL_BITS 2
+#define AST_HANDLE_POOL_MASK ((1u << AST_HANDLE_POOL_BITS) - 1)
+#define AST_MAX_POOL_NODES ((UINT32_MAX >> AST_HANDLE_POOL_BITS) - 1)
+struct ASTPool {
+  char **chunks; /* sb array */
+  unsigned int count;
+  size_t node_size;
+};
+/* the bytes a node of this type uses */
+size_t ast_node_size(enum ASTType type);
+unsigned int ast_pool_for_type(enum ASTType type);
+struct AST *ast_pool_node(struct ASTPool *pool, unsigned int index);
+/* the pools of the current tree, AST_POOL_COUNT of them */
+struct ASTPool *ast_get_pools(void);
+/* makes the nodes of pools the tree. The chunks and the arrays and
+ * strings of the nodes belong to the caller, ast_free_buffer only
+ * frees the chunk tables */
+void ast_borrow_pools(struct ASTPool *pools);
 #endif
@@ -0,0 +1,628 @@
+/*
+    This file is part of Ample.
+
+    Ample is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ample is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ample.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "ast_cache.h"
+#include "array.h"
+#include "ast.h"
+#include "symbol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* the loaded file, the tree points into it until it's closed */
+static char *ast_cache_data;
+static size_t ast_cache_size;
+
+#define AST_CACHE_OFFSET(ptr) ((void *) (uintptr_t) (ptr))
+#define AST_CACHE_RELOCATE(base, field)                                        \
+  ((field) = (field) ? (void *) ((base) + (uintptr_t) (field)) : NULL)
+
+bool32
+ASTCacheLoad (const char *cache_name,
+              const char *source,
+              size_t source_length,
+              ASTHandle *head)
+{
+  size_t size;
+  char *data;
+  struct ASTCacheHeader *header;
+  struct ASTPool pools[AST_POOL_COUNT];
+  const char *name;
+  size_t i;
+
+  if (SymbolCount () != 0)
+    return false;
+  data = ast_cache_map (cache_name, &size);
+  if (!data)
+    return false;
+  header = (struct ASTCacheHeader *) data;
+  if (size < sizeof (*header)
+      || 0 != memcmp (header->magic, AST_CACHE_MAGIC, sizeof (header->magic))
+      || header->version != AST_CACHE_VERSION
+      || header->byte_order != AST_CACHE_BYTE_ORDER
+      || header->node_size != sizeof (struct AST)
+      || header->pointer_size != sizeof (void *)
+      || header->file_size != size
+      || header->source_length != source_length
+      || header->symbols > size
+      || header->symbol_count > size
+      || header->source_hash != ast_cache_hash (source, source_length)
+      || header->data_hash != ast_cache_hash (data + sizeof (*header),
+                                              size - sizeof (*header)))
+    {
+      ast_cache_unmap (data, size);
+      return false;
+    }
+  for (i = 0; i < AST_POOL_COUNT; i++)
+    {
+      size_t node_size = ast_get_pools ()[i].node_size;
+      size_t chunk_count;
+      if (header->pool_counts[i] > AST_MAX_POOL_NODES
+          || header->pools[i] % AST_CACHE_ALIGN != 0
+          || header->pools[i] > size)
+        {
+          ast_cache_unmap (data, size);
+          return false;
+        }
+      chunk_count = (header->pool_counts[i] + AST_POOL_CHUNK_NODES - 1)
+                    / AST_POOL_CHUNK_NODES;
+      if (chunk_count * AST_POOL_CHUNK_NODES * node_size
+            > size - header->pools[i])
+        {
+          ast_cache_unmap (data, size);
+          return false;
+        }
+    }
+
+  /* every name has to end inside the file */
+  name = data + header->symbols;
+  for (i = 0; i < header->symbol_count; i++)
+    {
+      const char *end = memchr (name, '\0', data + size - name);
+      if (!end)
+        {
+          ast_cache_unmap (data, size);
+          return false;
+        }
+      name = end + 1;
+    }
+  /* the chunks of a pool were saved one after the other */
+  for (i = 0; i < AST_POOL_COUNT; i++)
+    {
+      size_t node_size = ast_get_pools ()[i].node_size;
+      unsigned int n;
+      for (n = 0; n < header->pool_counts[i]; n++)
+        {
+          const struct AST *node =
+            (const struct AST *) (data + header->pools[i] + n * node_size);
+          if (!ast_cache_check_node (data, size, header, node, i))
+            {
+              ast_cache_unmap (data, size);
+              return false;
+            }
+        }
+    }
+  if (!ast_cache_check_handle (header, header->head))
+    {
+      ast_cache_unmap (data, size);
+      return false;
+    }
+
+  /* ids are handed out in order, so interning the names in the
+   * order they were saved gives every symbol its old id */
+  name = data + header->symbols;
+  for (i = 0; i < header->symbol_count; i++)
+    {
+      size_t length = strlen (name);
+      SymbolIntern (name, length);
+      name += length + 1;
+    }
+
+  memcpy (pools, ast_get_pools (), sizeof (pools));
+  for (i = 0; i < AST_POOL_COUNT; i++)
+    {
+      struct ASTPool *pool = &pools[i];
+      size_t chunk_size = AST_POOL_CHUNK_NODES * pool->node_size;
+      unsigned int n;
+      pool->chunks = NULL;
+      pool->count = header->pool_counts[i];
+      for (n = 0; n < pool->count; n += AST_POOL_CHUNK_NODES)
+        {
+          char *chunk = data + header->pools[i]
+                        + n / AST_POOL_CHUNK_NODES * chunk_size;
+          ARRAY_PUSH (pool->chunks, chunk);
+        }
+      for (n = 0; n < pool->count; n++)
+        {
+          ast_cache_load_node (data, ast_pool_node (pool, n));
+        }
+    }
+  ast_borrow_pools (pools);
+  ast_cache_data = data;
+  ast_cache_size = size;
+  *head = header->head;
+  return true;
+}
+
+bool32
+ASTCacheStore (const char *cache_name,
+               const char *source,
+               size_t source_length,
+               ASTHandle head)
+{
+  struct ASTCacheWriter w = { 0 };
+  struct ASTCacheHeader header;
+  struct ASTPool *pools = ast_get_pools ();
+  size_t symbol_count = SymbolCount ();
+  size_t symbols_size = 0;
+  size_t i;
+  char *symbols;
+  char *temp_name;
+  FILE *f;
+  bool32 written;
+
+  memset (&header, 0, sizeof (header));
+  ast_cache_append (&w, NULL, sizeof (header));
+  for (i = 0; i < AST_POOL_COUNT; i++)
+    {
+      header.pools[i] = ast_cache_append_pool (&w, &pools[i]);
+      header.pool_counts[i] = pools[i].count;
+    }
+
+  for (i = 0; i < symbol_count; i++)
+    {
+      symbols_size += strlen (SymbolName (i)) + 1;
+    }
+  header.symbols = ast_cache_append (&w, NULL, symbols_size);
+  symbols = w.data + header.symbols;
+  for (i = 0; i < symbol_count; i++)
+    {
+      size_t length = strlen (SymbolName (i)) + 1;
+      memcpy (symbols, SymbolName (i), length);
+      symbols += length;
+    }
+
+  memcpy (header.magic, AST_CACHE_MAGIC, sizeof (header.magic));
+  header.version = AST_CACHE_VERSION;
+  header.byte_order = AST_CACHE_BYTE_ORDER;
+  header.node_size = sizeof (struct AST);
+  header.pointer_size = sizeof (void *);
+  header.source_hash = ast_cache_hash (source, source_length);
+  header.source_length = source_length;
+  header.file_size = w.size;
+  header.data_hash = ast_cache_hash (w.data + sizeof (header),
+                                     w.size - sizeof (header));
+  header.head = head;
+  header.symbol_count = symbol_count;
+  memcpy (w.data, &header, sizeof (header));
+
+  /* written to the side and renamed, so a run that reads the
+   * cache while it's being written never sees half a file */
+  temp_name = malloc (strlen (cache_name) + sizeof (".tmp"));
+  strcpy (temp_name, cache_name);
+  strcat (temp_name, ".tmp");
+  f = fopen (temp_name, "wb");
+  written = f != NULL;
+  if (f)
+    {
+      written = fwrite (w.data, 1, w.size, f) == w.size;
+      written = (0 == fclose (f)) && written;
+#ifdef _WIN32
+      if (written)
+        remove (cache_name);
+#endif
+      written = written && (0 == rename (temp_name, cache_name));
+      if (!written)
+        remove (temp_name);
+    }
+  free (temp_name);
+  free (w.data);
+  return written;
+}
+
+void
+ASTCacheClose (void)
+{
+  if (ast_cache_data)
+    ast_cache_unmap (ast_cache_data, ast_cache_size);
+  ast_cache_data = NULL;
+  ast_cache_size = 0;
+}
+
+uint64_t
+ast_cache_hash (const char *source, size_t length)
+{
+  /* FNV-1a */
+  const unsigned char *us = (const unsigned char *) source;
+  uint64_t h = 14695981039346656037ull;
+  size_t i;
+  for (i = 0; i < length; i++)
+    {
+      h ^= us[i];
+      h *= 1099511628211ull;
+    }
+  return h;
+}
+
+size_t
+ast_cache_append (struct ASTCacheWriter *w, const void *data, size_t size)
+{
+  size_t offset = (w->size + AST_CACHE_ALIGN - 1)
+                  & ~(size_t) (AST_CACHE_ALIGN - 1);
+  if (offset + size > w->capacity)
+    {
+      size_t capacity = w->capacity ? w->capacity : 4096;
+      while (offset + size > capacity)
+        capacity *= 2;
+      w->data = w->data ? realloc (w->data, capacity) : malloc (capacity);
+      w->capacity = capacity;
+    }
+  /* the padding is zeroed so the file doesn't depend on
+   * whatever was in memory */
+  memset (w->data + w->size, 0, offset - w->size);
+  if (data)
+    memcpy (w->data + offset, data, size);
+  else
+    memset (w->data + offset, 0, size);
+  w->size = offset + size;
+  return offset;
+}
+
+size_t
+ast_cache_append_array (struct ASTCacheWriter *w, void *arr, size_t item_size)
+{
+  size_t count = ARRAY_COUNT (arr);
+  size_t header_size = offsetof (struct Array_Buffer, buffer);
+  struct Array_Buffer *buff;
+  size_t offset;
+  if (count == 0)
+    return 0;
+  offset = ast_cache_append (w, NULL, header_size + count * item_size);
+  buff = (struct Array_Buffer *) (w->data + offset);
+  /* nothing is ever pushed onto a loaded array */
+  buff->count = count;
+  buff->capacity = count;
+  memcpy (buff->buffer, arr, count * item_size);
+  return offset + header_size;
+}
+
+size_t
+ast_cache_append_pool (struct ASTCacheWriter *w, struct ASTPool *pool)
+{
+  size_t chunk_count = ARRAY_COUNT (pool->chunks);
+  size_t offset = ast_cache_append (w,
+                                    NULL,
+                                    chunk_count * AST_POOL_CHUNK_NODES
+                                      * pool->node_size);
+  unsigned int i;
+  for (i = 0; i < pool->count; i++)
+    {
+      /* a node is only as big as its pool's nodes, and appending
+       * can move the buffer, so it's converted on the side */
+      struct AST node;
+      memcpy (&node, ast_pool_node (pool, i), pool->node_size);
+      ast_cache_store_node (w, &node);
+      memcpy (w->data + offset + i * pool->node_size, &node, pool->node_size);
+    }
+  return offset;
+}
+
+void
+ast_cache_store_node (struct ASTCacheWriter *w, struct AST *node)
+{
+  switch (node->type)
+    {
+    case AST_SCOPE:
+      node->d.scope_data.statements = AST_CACHE_OFFSET (
+        ast_cache_append_array (w,
+                                node->d.scope_data.statements,
+                                sizeof (ASTHandle)));
+      node->d.scope_data.locals = AST_CACHE_OFFSET (
+        ast_cache_append_array (w,
+                                node->d.scope_data.locals,
+                                sizeof (Symbol)));
+      break;
+    case AST_STRING:
+      node->d.str_data.str = AST_CACHE_OFFSET (
+        ast_cache_append (w,
+                          node->d.str_data.str,
+                          strlen (node->d.str_data.str) + 1));
+      break;
+    case AST_FUNC:
+      node->d.func_data.args = AST_CACHE_OFFSET (
+        ast_cache_append_array (w,
+                                node->d.func_data.args,
+                                sizeof (ASTHandle)));
+      node->d.func_data.locals = AST_CACHE_OFFSET (
+        ast_cache_append_array (w,
+                                node->d.func_data.locals,
+                                sizeof (Symbol)));
+      break;
+    case AST_FUNC_CALL:
+      node->d.func_call_data.args = AST_CACHE_OFFSET (
+        ast_cache_append_array (w,
+                                node->d.func_call_data.args,
+                                sizeof (ASTHandle)));
+      break;
+    case AST_LIST:
+      node->d.list_data.items = AST_CACHE_OFFSET (
+        ast_cache_append_array (w,
+                                node->d.list_data.items,
+                                sizeof (ASTHandle)));
+      break;
+    default:
+      break;
+    }
+}
+
+void
+ast_cache_load_node (char *base, struct AST *node)
+{
+  switch (node->type)
+    {
+    case AST_SCOPE:
+      AST_CACHE_RELOCATE (base, node->d.scope_data.statements);
+      AST_CACHE_RELOCATE (base, node->d.scope_data.locals);
+      break;
+    case AST_STRING:
+      AST_CACHE_RELOCATE (base, node->d.str_data.str);
+      break;
+    case AST_FUNC:
+      AST_CACHE_RELOCATE (base, node->d.func_data.args);
+      AST_CACHE_RELOCATE (base, node->d.func_data.locals);
+      break;
+    case AST_FUNC_CALL:
+      AST_CACHE_RELOCATE (base, node->d.func_call_data.args);
+      break;
+    case AST_LIST:
+      AST_CACHE_RELOCATE (base, node->d.list_data.items);
+      break;
+    default:
+      break;
+    }
+}
+
+bool32
+ast_cache_check_handle (const struct ASTCacheHeader *header, ASTHandle handle)
+{
+  unsigned int pool = handle & AST_HANDLE_POOL_MASK;
+  unsigned int index = handle >> AST_HANDLE_POOL_BITS;
+  if (handle == 0)
+    return true;
+  /* node indices start at 1, so a handle with pool bits but no index
+   * doesn't name a node */
+  return pool < AST_POOL_COUNT
+         && index >= 1
+         && index <= header->pool_counts[pool];
+}
+
+bool32
+ast_cache_check_symbol (const struct ASTCacheHeader *header, Symbol symbol)
+{
+  return symbol < header->symbol_count;
+}
+
+bool32
+ast_cache_check_array (const char *base,
+                       size_t size,
+                       const void *offset,
+                       size_t item_size,
+                       size_t *count)
+{
+  size_t header_size = offsetof (struct Array_Buffer, buffer);
+  uintptr_t items = (uintptr_t) offset;
+  const struct Array_Buffer *buff;
+  *count = 0;
+  if (!items)
+    return true;
+  if (items < header_size || items > size
+      || (items - header_size) % AST_CACHE_ALIGN != 0)
+    return false;
+  buff = (const struct Array_Buffer *) (base + items - header_size);
+  *count = buff->count;
+  return buff->count <= (size - items) / item_size;
+}
+
+bool32
+ast_cache_check_handles (const char *base,
+                         size_t size,
+                         const struct ASTCacheHeader *header,
+                         const ASTHandle *offset)
+{
+  const ASTHandle *handles = (const ASTHandle *) (base + (uintptr_t) offset);
+  size_t count;
+  size_t i;
+  if (!ast_cache_check_array (base, size, offset, sizeof (ASTHandle), &count))
+    return false;
+  for (i = 0; i < count; i++)
+    {
+      if (!ast_cache_check_handle (header, handles[i]))
+        return false;
+    }
+  return true;
+}
+
+bool32
+ast_cache_check_symbols (const char *base,
+                         size_t size,
+                         const struct ASTCacheHeader *header,
+                         const Symbol *offset)
+{
+  const Symbol *symbols = (const Symbol *) (base + (uintptr_t) offset);
+  size_t count;
+  size_t i;
+  if (!ast_cache_check_array (base, size, offset, sizeof (Symbol), &count))
+    return false;
+  for (i = 0; i < count; i++)
+    {
+      if (!ast_cache_check_symbol (header, symbols[i]))
+        return false;
+    }
+  return true;
+}
+
+bool32
+ast_cache_check_string (const char *base, size_t size, const char *offset)
+{
+  uintptr_t start = (uintptr_t) offset;
+  return start > 0 && start < size
+         && memchr (base + start, '\0', size - start) != NULL;
+}
+
+bool32
+ast_cache_check_node (const char *base,
+                      size_t size,
+                      const struct ASTCacheHeader *header,
+                      const struct AST *node,
+                      unsigned int pool)
+{
+  const union data *d = &node->d;
+#define X(type, data) + 1
+  const unsigned int type_count = 0 AST_TYPES;
+#undef X
+#define CHECK_HANDLE(handle) ast_cache_check_handle (header, (handle))
+#define CHECK_SYMBOL(symbol) ast_cache_check_symbol (header, (symbol))
+#define CHECK_HANDLES(arr) ast_cache_check_handles (base, size, header, (arr))
+#define CHECK_SYMBOLS(arr) ast_cache_check_symbols (base, size, header, (arr))
+  bool32 ok = false;
+
+  if ((unsigned int) node->type >= type_count
+      || ast_pool_for_type (node->type) != pool)
+    return false;
+  switch (node->type)
+    {
+    case AST_INTEGER:
+    case AST_BOOL:
+      ok = true;
+      break;
+    case AST_STRING:
+      ok = ast_cache_check_string (base, size, d->str_data.str);
+      break;
+    case AST_IDENTIFIER:
+      ok = CHECK_SYMBOL (d->id_data.id);
+      break;
+    case AST_SCOPE:
+      ok = CHECK_HANDLES (d->scope_data.statements)
+           && CHECK_SYMBOLS (d->scope_data.locals);
+      break;
+    case AST_BINARY_OP:
+      ok = CHECK_HANDLE (d->bop_data.left) && CHECK_HANDLE (d->bop_data.right);
+      break;
+    case AST_ASSIGNMENT:
+      ok = CHECK_SYMBOL (d->asgn_data.var) && CHECK_HANDLE (d->asgn_data.expr);
+      break;
+    case AST_IF:
+      ok = CHECK_HANDLE (d->if_data.expr)
+           && CHECK_HANDLE (d->if_data.scope_if_true)
+           && CHECK_HANDLE (d->if_data.scope_if_false);
+      break;
+    case AST_BINARY_COMPARATOR:
+      ok = CHECK_HANDLE (d->bcmp_data.left)
+           && CHECK_HANDLE (d->bcmp_data.right);
+      break;
+    case AST_FUNC:
+      ok = CHECK_HANDLES (d->func_data.args)
+           && CHECK_SYMBOLS (d->func_data.locals)
+           && CHECK_SYMBOL (d->func_data.name)
+           && CHECK_HANDLE (d->func_data.scope);
+      break;
+    case AST_FUNC_CALL:
+      ok = CHECK_HANDLES (d->func_call_data.args)
+           && CHECK_SYMBOL (d->func_call_data.name)
+           && CHECK_HANDLE (d->func_call_data.cached_func);
+      break;
+    case AST_LIST:
+      ok = CHECK_HANDLES (d->list_data.items);
+      break;
+    case AST_WHILE:
+      ok = CHECK_HANDLE (d->while_data.expr)
+           && CHECK_HANDLE (d->while_data.scope);
+      break;
+    case AST_FOR:
+      ok = CHECK_HANDLE (d->for_data.init) && CHECK_HANDLE (d->for_data.expr)
+           && CHECK_HANDLE (d->for_data.step)
+           && CHECK_HANDLE (d->for_data.scope);
+      break;
+    }
+#undef CHECK_HANDLE
+#undef CHECK_SYMBOL
+#undef CHECK_HANDLES
+#undef CHECK_SYMBOLS
+  return ok;
+}
+
+char *
+ast_cache_map (const char *cache_name, size_t *size)
+{
+#ifndef _WIN32
+  int fd = open (cache_name, O_RDONLY);
+  struct stat st;
+  void *data = MAP_FAILED;
+  if (fd < 0)
+    return NULL;
+  if (fstat (fd, &st) == 0 && S_ISREG (st.st_mode) && st.st_size > 0)
+    {
+      /* private and writable, only the pages of the nodes get
+       * copied when their pointers are relocated */
+      data = mmap (NULL, st.st_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE, fd, 0);
+    }
+  close (fd);
+  if (data == MAP_FAILED)
+    return NULL;
+  *size = st.st_size;
+  return data;
+#else
+  FILE *f = fopen (cache_name, "rb");
+  char *data;
+  long length;
+  if (!f)
+    return NULL;
+  if (fseek (f, 0, SEEK_END) != 0 || (length = ftell (f)) <= 0
+      || fseek (f, 0, SEEK_SET) != 0)
+    {
+      fclose (f);
+      return NULL;
+    }
+  data = malloc (length);
+  if (fread (data, 1, length, f) != (size_t) length)
+    {
+      free (data);
+      data = NULL;
+    }
+  fclose (f);
+  *size = length;
+  return data;
+#endif
+}
+
+void
+ast_cache_unmap (char *data, size_t size)
+{
+#ifndef _WIN32
+  munmap (data, size);
+#else
+  (void) size;
+  free (data);
+#endif
+}
@@ -0,0 +1,141 @@
+/*
+    This file is part of Ample.
+
+    Ample is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ample is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ample.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef AST_CACHE_H_
+#define AST_CACHE_H_
+#include "ast.h"
+#include "bool.h"
+#include <stddef.h>
+#include <stdint.h>
+/* ******************
+   External functions
+   ****************** */
+/* A resolved tree can be saved next to its script ("x.ample.astc")
+ * and mapped back in on later runs instead of lexing and parsing the
+ * script again. The file is an image of the tree: the node pools,
+ * chunk after chunk, followed by the arrays and strings the nodes
+ * point to, laid out the way the ARRAY_* macros lay out arrays, with
+ * pointers stored as offsets into the file. Loading relocates those
+ * offsets in one pass over the nodes, the chunks, arrays and strings
+ * are used where they are mapped.
+ *
+ * A cache is only used if it was made from the same source by a
+ * build with the same tree layout and is intact, anything else is a
+ * miss */
+
+/* returns false if the cache is missing or stale, otherwise the tree
+ * becomes the current one and *head is its head. The symbol table
+ * has to be empty, the cached symbols get their old ids back */
+bool32 ASTCacheLoad(const char *cache_name,
+                    const char *source,
+                    size_t source_length,
+                    ASTHandle *head);
+/* writes the current tree, returns false if the file can't be written */
+bool32 ASTCacheStore(const char *cache_name,
+                     const char *source,
+                     size_t source_length,
+                     ASTHandle head);
+/* call this AFTER ast_free_buffer */
+void ASTCacheClose(void);
+
+/* ******************
+   Internal Functions
+   ****************** */
+/* bump this whenever the meaning of a node changes, size
+ * changes are caught by the header on their own */
+#define AST_CACHE_VERSION 6
+#define AST_CACHE_MAGIC "AMPASTC"
+#define AST_CACHE_BYTE_ORDER 0x01020304u
+#define AST_CACHE_ALIGN 8
+
+struct ASTCacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t node_size;
+  uint32_t pointer_size;
+  uint64_t source_hash;
+  uint64_t source_length;
+  /* of the bytes after the header, so damage to fields that aren't
+   * offsets, a variable's slot say, is caught as well */
+  uint64_t data_hash;
+  uint64_t file_size;
+  uint64_t head;
+  uint64_t pools[AST_POOL_COUNT];      /* offset of the first chunk */
+  uint64_t pool_counts[AST_POOL_COUNT];
+  uint64_t symbols;      /* offset of the symbol names, NUL separated */
+  uint64_t symbol_count;
+};
+
+/* the file being built by ASTCacheStore */
+struct ASTCacheWriter {
+  char *data;
+  size_t size;
+  size_t capacity;
+};
+
+uint64_t ast_cache_hash(const char *source, size_t length);
+/* appends size bytes, aligned, and returns their offset */
+size_t ast_cache_append(struct ASTCacheWriter *w,
+                        const void *data,
+                        size_t size);
+/* appends an array in the layout of the ARRAY_* macros and returns
+ * the offset of its first item, 0 for an empty array */
+size_t ast_cache_append_array(struct ASTCacheWriter *w,
+                              void *arr,
+                              size_t item_size);
+/* appends the nodes of a pool as whole chunks and
+ * returns the offset of the first one */
+size_t ast_cache_append_pool(struct ASTCacheWriter *w, struct ASTPool *pool);
+/* turns the pointers of a copied node into file offsets */
+void ast_cache_store_node(struct ASTCacheWriter *w, struct AST *node);
+/* turns the file offsets of a mapped node back into pointers */
+void ast_cache_load_node(char *base, struct AST *node);
+/* A file that was cut short or damaged is a miss like a stale one.
+ * These check what a mapped file refers to, before anything in it is
+ * used: offsets have to land inside the size bytes of the file,
+ * handles on saved nodes and symbols on saved names */
+bool32 ast_cache_check_handle(const struct ASTCacheHeader *header,
+                              ASTHandle handle);
+bool32 ast_cache_check_symbol(const struct ASTCacheHeader *header,
+                              Symbol symbol);
+/* a stored array offset, its items are count items of item_size */
+bool32 ast_cache_check_array(const char *base,
+                             size_t size,
+                             const void *offset,
+                             size_t item_size,
+                             size_t *count);
+bool32 ast_cache_check_handles(const char *base,
+                               size_t size,
+                               const struct ASTCacheHeader *header,
+                               const ASTHandle *offset);
+bool32 ast_cache_check_symbols(const char *base,
+                               size_t size,
+                               const struct ASTCacheHeader *header,
+                               const Symbol *offset);
+bool32 ast_cache_check_string(const char *base,
+                              size_t size,
+                              const char *offset);
+/* a node of pool, not yet relocated */
+bool32 ast_cache_check_node(const char *base,
+                            size_t size,
+                            const struct ASTCacheHeader *header,
+                            const struct AST *node,
+                            unsigned int pool);
+/* reads or maps the whole file writable, NULL if it can't */
+char *ast_cache_map(const char *cache_name, size_t *size);
+void ast_cache_unmap(char *data, size_t size);
+#endif
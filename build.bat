@@ -1 +1 @@
-clang-cl build.c /Z7 /TC /W4 /Feample-cl /link /STACK:0x10000000
+clang-cl build.c /Z7 /TC /W4 /Feample-cl
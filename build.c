@@ -5,7 +5,9 @@
 /* possible debug defines:
  * MEM_DEBUG,
  * PARSER_DEBUG 
- * INTERPRETER_DEBUG */
+ * INTERPRETER_DEBUG
+ * BYTECODE_DEBUG
+ * ALLOCATOR_DEBUG */
 #define MEM_DEBUG
 #include "mem_debug_public.h"
 #include "mem_debug.c"
@@ -19,14 +21,20 @@
 #include "objects/listobject.c"
 
 #include "ast.c"
-#include "dict_vars.c"
+#include "ast_cache.c"
+#include "bytecode.c"
+#include "compiler.c"
 #include "hash.c"
 #include "interpreter.c"
 #include "interpreter_functions.c"
 #include "lexer.c"
 #include "ncl.c"
+#include "optimizer.c"
 #include "parser.c"
+#include "resolver.c"
 #include "ssl.c"
+#include "symbol.c"
+#include "vm.c"
 
 
 #include "main.c"
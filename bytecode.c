@@ -0,0 +1,110 @@
+/*
+    This file is part of Ample.
+
+    Ample is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ample is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ample.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "bytecode.h"
+#include "array.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define X(op) #op,
+const char *BYTECODE_OP_STR[] = {
+  BYTECODE_OPS
+};
+#undef X
+
+struct BytecodeFunction *
+BytecodeFunctionCreate (Symbol name)
+{
+  struct BytecodeFunction *function = calloc (1, sizeof (*function));
+  function->name = name;
+  return function;
+}
+
+void
+BytecodeFunctionFree (struct BytecodeFunction *function)
+{
+  size_t i;
+  for (i = 0; i < ARRAY_COUNT (function->constants); i++)
+    {
+      AmpValue constant = function->constants[i];
+      if (AMP_VALUE_IS_OBJECT (constant))
+        AmpObjectDestroyImmortal (AMP_VALUE_TO_OBJECT (constant));
+    }
+  for (i = 0; i < ARRAY_COUNT (function->functions); i++)
+    {
+      BytecodeFunctionFree (function->functions[i]);
+    }
+  ARRAY_FREE (function->params);
+  ARRAY_FREE (function->locals);
+  ARRAY_FREE (function->code);
+  ARRAY_FREE (function->constants);
+  ARRAY_FREE (function->names);
+  ARRAY_FREE (function->call_sites);
+  ARRAY_FREE (function->functions);
+  free (function);
+}
+
+const char *
+BytecodeFunctionName (const struct BytecodeFunction *function)
+{
+  return function->name != SYMBOL_NONE ? SymbolName (function->name)
+                                       : "<script>";
+}
+
+void
+BytecodeFunctionPrint (struct BytecodeFunction *function)
+{
+  size_t i;
+  printf ("function %s: %u registers\n",
+          BytecodeFunctionName (function),
+          function->register_count);
+  for (i = 0; i < ARRAY_COUNT (function->code); i++)
+    {
+      Instruction ins = function->code[i];
+      printf ("  %4u  %-16s ", (unsigned int) i, BYTECODE_OP_STR[INS_OP (ins)]);
+      switch (INS_OP (ins))
+        {
+        case OP_LOAD_CONST:
+        case OP_FUNC:
+          printf ("%u %u\n", INS_A (ins), INS_BX (ins));
+          break;
+        case OP_GET_GLOBAL:
+        case OP_SET_GLOBAL:
+          printf ("%u %s\n", INS_A (ins), SymbolName (function->globals[INS_BX (ins)]));
+          break;
+        case OP_CALL:
+        case OP_TAIL_CALL:
+          {
+            struct CallSite *site = &function->call_sites[INS_BX (ins)];
+            printf ("%u %s (%u args)\n",
+                    INS_A (ins),
+                    SymbolName (function->names[site->name]),
+                    site->arg_count);
+          }
+          break;
+        case OP_JUMP:
+          printf ("-> %d\n", (int) i + 1 + INS_SAX (ins));
+          break;
+        default:
+          printf ("%u %u %u\n", INS_A (ins), INS_B (ins), INS_C (ins));
+          break;
+        }
+    }
+  for (i = 0; i < ARRAY_COUNT (function->functions); i++)
+    {
+      BytecodeFunctionPrint (function->functions[i]);
+    }
+}
@@ -0,0 +1,133 @@
+/*
+    This file is part of Ample.
+
+    Ample is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ample is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ample.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BYTECODE_H_
+#define BYTECODE_H_
+#include "objects/ampobject.h"
+#include "symbol.h"
+#include <stdint.h>
+
+/* Instructions are 32 bits wide. The low 8 bits hold the opcode,
+ * the rest hold the operands in one of three layouts:
+ *   A B C : three 8 bit fields
+ *   A Bx  : an 8 bit field and a 16 bit unsigned index
+ *   sAx   : a 24 bit signed offset, only used by jumps
+ * R(x) is register x of the running function, K(x) its constant x,
+ * N(x) its name x, S(x) its call site x, P(x) its nested function x
+ * and G(x) global variable x.
+ *
+ * The variables of a function are its lowest registers, the arguments
+ * first. Variables of an if/else body take the registers above them
+ * while the body runs. A called function's registers start at the
+ * register of its first argument, so arguments are passed in place */
+typedef uint32_t Instruction;
+
+#define BYTECODE_OPS \
+  X(OP_LOAD_CONST)     /* A Bx  : R(A) = K(Bx) */                            \
+  X(OP_MOVE)           /* A B   : R(A) = R(B) */                             \
+  X(OP_GET_LOCAL)      /* A B   : R(A) = R(B), R(B) has to be assigned */    \
+  X(OP_SET_LOCAL)      /* A B   : R(A) = R(B), R(B) is left empty */         \
+  X(OP_GET_GLOBAL)     /* A Bx  : R(A) = G(Bx), G(Bx) has to be assigned */  \
+  X(OP_SET_GLOBAL)     /* A Bx  : G(Bx) = R(A), R(A) is left empty */        \
+  X(OP_ADD)            /* A B C : R(A) = R(B) + R(C) */                      \
+  X(OP_SUB)            /* A B C : R(A) = R(B) - R(C) */                      \
+  X(OP_MUL)            /* A B C : R(A) = R(B) * R(C) */                      \
+  X(OP_DIV)            /* A B C : R(A) = R(B) / R(C) */                      \
+  X(OP_EQUAL)          /* A B C : R(A) = R(B) == R(C) */                     \
+  X(OP_NOT_EQUAL)      /* A B C : R(A) = R(B) != R(C) */                     \
+  X(OP_LESS_THAN)      /* A B C : R(A) = R(B) < R(C) */                      \
+  X(OP_GREATER_THAN)   /* A B C : R(A) = R(B) > R(C) */                      \
+  X(OP_LIST)           /* A B C : R(A) = [R(B) ... R(B+C-1)] */              \
+  X(OP_APPEND)         /* A B C : R(A) += [R(B) ... R(B+C-1)] */             \
+  X(OP_TEST)           /* A     : skip the next instruction if R(A) true */  \
+  X(OP_JUMP)           /* sAx   : ip += sAx */                               \
+  X(OP_ENTER_SCOPE)    /* A B   : unassign the locals R(A) ... R(A+B-1) */   \
+  X(OP_LEAVE_SCOPE)    /* A B   : release the locals R(A) ... R(A+B-1) */    \
+  X(OP_FUNC)           /* Bx    : define function P(Bx) */                   \
+  X(OP_CALL)           /* A Bx  : R(A) = S(Bx) called with R(A)... */        \
+  X(OP_TAIL_CALL)      /* A Bx  : OP_CALL, a user defined function replaces  \
+                                  the running one */                         \
+  X(OP_RETURN)         /* A B   : return R(A) if B, otherwise nothing */
+
+#define X(op) op,
+typedef enum OpCode {
+  BYTECODE_OPS
+  OP_COUNT
+} OpCode;
+#undef X
+
+#define INS_OP(i) ((OpCode) ((i) & 0xFF))
+#define INS_A(i) (((i) >> 8) & 0xFF)
+#define INS_B(i) (((i) >> 16) & 0xFF)
+#define INS_C(i) (((i) >> 24) & 0xFF)
+#define INS_BX(i) (((i) >> 16) & 0xFFFF)
+#define INS_SAX(i) ((int32_t) ((i) >> 8) - INS_SAX_BIAS)
+
+#define INS_MAX_A 0xFF
+#define INS_MAX_BX 0xFFFF
+#define INS_SAX_BIAS 0x7FFFFF
+
+#define INS_ABC(op, a, b, c)                                                   \
+  ((Instruction) (op) | ((Instruction) (a) << 8) | ((Instruction) (b) << 16)   \
+   | ((Instruction) (c) << 24))
+#define INS_ABX(op, a, bx)                                                     \
+  ((Instruction) (op) | ((Instruction) (a) << 8) | ((Instruction) (bx) << 16))
+#define INS_SAX_ENCODE(op, sax)                                                \
+  ((Instruction) (op) | ((Instruction) ((sax) + INS_SAX_BIAS) << 8))
+
+struct CallSite {
+  unsigned int name; /* index into names */
+  unsigned int arg_count;
+  unsigned int builtin; /* AmpleBuiltinId, used without a user function */
+  unsigned int tail;    /* CallTail of the call */
+  /* what the name meant the last time the call ran, only
+   * good while generation is the vm's generation */
+  struct BytecodeFunction *cached_callee; /* NULL for a builtin */
+  unsigned int generation;
+};
+
+/* names a register holding a variable while the instructions
+ * [start, end) run, used for error messages */
+struct LocalVariable {
+  Symbol name;
+  unsigned int reg;
+  unsigned int start;
+  unsigned int end;
+};
+
+/* A compiled function. The top level of a script is compiled
+ * into one of these as well */
+struct BytecodeFunction {
+  Symbol name;                         /* SYMBOL_NONE for the top level */
+  Symbol *params;                      /* array */
+  Symbol *globals;                     /* array, names of the global slots */
+  struct LocalVariable *locals;        /* array */
+  Instruction *code;                   /* array */
+  AmpValue *constants;                 /* array, owning, immortal */
+  Symbol *names;                       /* array */
+  struct CallSite *call_sites;         /* array */
+  struct BytecodeFunction **functions; /* array, owning */
+  unsigned int local_count; /* registers used by function level variables */
+  unsigned int register_count;
+};
+
+struct BytecodeFunction *BytecodeFunctionCreate (Symbol name);
+/* the name to show in messages */
+const char *BytecodeFunctionName (const struct BytecodeFunction *function);
+/* frees the function and every function nested inside of it */
+void BytecodeFunctionFree (struct BytecodeFunction *function);
+void BytecodeFunctionPrint (struct BytecodeFunction *function);
+#endif
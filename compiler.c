@@ -0,0 +1,555 @@
+/*
+    This file is part of Ample.
+
+    Ample is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ample is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ample.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "compiler.h"
+#include "array.h"
+#include "ast.h"
+#include "bytecode.h"
+#include "ample_errors.h"
+#include "interpreter_functions.h"
+#include "objects/ampobject.h"
+#include "objects/numobject.h"
+#include "objects/boolobject.h"
+#include "objects/strobject.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* maximum amount of items put into a list by one instruction */
+#define COMPILER_LIST_BATCH 32
+
+struct BytecodeFunction *
+CompileProgram (ASTHandle head)
+{
+  struct Compiler c = { 0 };
+  struct AST *head_node = ast_get_node (head);
+  c.function = BytecodeFunctionCreate (SYMBOL_NONE);
+  if (head_node)
+    c.function->globals = head_node->d.scope_data.locals;
+  if (ARRAY_COUNT (c.function->globals) > INS_MAX_BX + 1)
+    {
+      printf ("Too many global variables\n");
+      exit (1);
+    }
+  compiler_compile_statements (&c, head);
+  compiler_emit (&c, INS_ABC (OP_RETURN, 0, 0, 0));
+  ARRAY_FREE (c.scope_bases);
+
+#ifdef BYTECODE_DEBUG
+  BytecodeFunctionPrint (c.function);
+#endif
+  return c.function;
+}
+
+unsigned int
+compiler_emit (struct Compiler *c, Instruction ins)
+{
+  ARRAY_PUSH (c->function->code, ins);
+  return ARRAY_COUNT (c->function->code) - 1;
+}
+
+void
+compiler_patch_jump (struct Compiler *c, unsigned int jump_index)
+{
+  int offset = (int) ARRAY_COUNT (c->function->code) - (int) jump_index - 1;
+  c->function->code[jump_index] = INS_SAX_ENCODE (OP_JUMP, offset);
+}
+
+unsigned int
+compiler_allocate_register (struct Compiler *c)
+{
+  unsigned int reg = c->free_register++;
+  if (reg > INS_MAX_A)
+    {
+      printf ("Expression is too complex, it needs more than %u registers\n",
+              INS_MAX_A + 1);
+      exit (1);
+    }
+  if (c->free_register > c->function->register_count)
+    c->function->register_count = c->free_register;
+  return reg;
+}
+
+void
+compiler_free_registers (struct Compiler *c, unsigned int first)
+{
+  c->free_register = first;
+}
+
+unsigned int
+compiler_add_constant (struct Compiler *c, AmpValue obj)
+{
+  size_t index = ARRAY_COUNT (c->function->constants);
+  if (index > INS_MAX_BX)
+    {
+      printf ("Too many constants in function \"%s\"\n",
+              BytecodeFunctionName (c->function));
+      exit (1);
+    }
+  /* loading a constant shouldn't have to touch its refcount */
+  if (AMP_VALUE_IS_OBJECT (obj))
+    AmpObjectMakeImmortal (AMP_VALUE_TO_OBJECT (obj));
+  ARRAY_PUSH (c->function->constants, obj);
+  return index;
+}
+
+unsigned int
+compiler_add_name (struct Compiler *c, Symbol name)
+{
+  size_t i;
+  size_t count = ARRAY_COUNT (c->function->names);
+  for (i = 0; i < count; i++)
+    {
+      if (c->function->names[i] == name)
+        return i;
+    }
+  if (count > INS_MAX_BX)
+    {
+      printf ("Too many names in function \"%s\"\n",
+              BytecodeFunctionName (c->function));
+      exit (1);
+    }
+  ARRAY_PUSH (c->function->names, name);
+  return count;
+}
+
+unsigned int
+compiler_local_register (struct Compiler *c, const struct VarLocation *loc)
+{
+  size_t count = ARRAY_COUNT (c->scope_bases);
+  return c->scope_bases[count - 1 - loc->depth] + loc->slot;
+}
+
+void
+compiler_add_local_names (struct Compiler *c,
+                          Symbol *names,
+                          unsigned int first_register,
+                          unsigned int start)
+{
+  size_t i;
+  for (i = 0; i < ARRAY_COUNT (names); i++)
+    {
+      struct LocalVariable local;
+      local.name = names[i];
+      local.reg = first_register + i;
+      local.start = start;
+      local.end = ARRAY_COUNT (c->function->code);
+      ARRAY_PUSH (c->function->locals, local);
+    }
+}
+
+void
+compiler_compile_statements (struct Compiler *c, ASTHandle scope_handle)
+{
+  struct AST *scope = ast_get_node (scope_handle);
+  size_t i;
+  if (!scope)
+    return;
+  for (i = 0; i < ARRAY_COUNT (scope->d.scope_data.statements); i++)
+    {
+      compiler_compile_statement (c, scope->d.scope_data.statements[i]);
+    }
+}
+
+void
+compiler_compile_block (struct Compiler *c, ASTHandle scope_handle)
+{
+  struct AST *scope = ast_get_node (scope_handle);
+  unsigned int local_count;
+  unsigned int base = c->free_register;
+  unsigned int start;
+  unsigned int i;
+  /* empty scopes are never given a node by the parser */
+  if (!scope)
+    return;
+  if (!scope->d.scope_data.has_frame)
+    {
+      compiler_compile_statements (c, scope_handle);
+      return;
+    }
+
+  /* the block's variables sit right above the ones around it */
+  local_count = ARRAY_COUNT (scope->d.scope_data.locals);
+  for (i = 0; i < local_count; i++)
+    {
+      compiler_allocate_register (c);
+    }
+  ARRAY_PUSH (c->scope_bases, base);
+
+  /* registers are reused, so a variable can't be left
+   * holding a value from before the block was entered */
+  start = compiler_emit (c, INS_ABC (OP_ENTER_SCOPE, base, local_count, 0));
+  compiler_compile_statements (c, scope_handle);
+  compiler_emit (c, INS_ABC (OP_LEAVE_SCOPE, base, local_count, 0));
+  compiler_add_local_names (c, scope->d.scope_data.locals, base, start);
+
+  ARRAY_POP (c->scope_bases);
+  compiler_free_registers (c, base);
+}
+
+void
+compiler_compile_statement (struct Compiler *c, ASTHandle handle)
+{
+  struct AST *node = ast_get_node (handle);
+  unsigned int reg;
+  switch (node->type)
+    {
+    case AST_ASSIGNMENT:
+      {
+        const struct VarLocation *loc = &node->d.asgn_data.loc;
+        reg = compiler_allocate_register (c);
+        compiler_compile_expression (c, node->d.asgn_data.expr, reg);
+        if (loc->global)
+          compiler_emit (c, INS_ABX (OP_SET_GLOBAL, reg, loc->slot));
+        else
+          compiler_emit (c, INS_ABC (OP_SET_LOCAL,
+                                     compiler_local_register (c, loc),
+                                     reg,
+                                     0));
+        compiler_free_registers (c, reg);
+      }
+      break;
+    case AST_IF:
+      compiler_compile_if (c, handle);
+      break;
+    case AST_WHILE:
+    case AST_FOR:
+      compiler_compile_loop (c, handle);
+      break;
+    case AST_FUNC:
+      {
+        struct BytecodeFunction *function =
+          compiler_compile_function (handle, c->function->globals);
+        size_t index = ARRAY_COUNT (c->function->functions);
+        ARRAY_PUSH (c->function->functions, function);
+        compiler_emit (c, INS_ABX (OP_FUNC, 0, index));
+      }
+      break;
+    case AST_FUNC_CALL:
+      if (node->d.func_call_data.builtin == AMPLE_BUILTIN_RETURN)
+        {
+          compiler_compile_return (c, handle);
+          break;
+        }
+      reg = compiler_allocate_register (c);
+      compiler_compile_call (c, handle, reg);
+      compiler_free_registers (c, reg);
+      break;
+    case AST_IDENTIFIER:
+      /* a lone variable has no effect */
+      break;
+    default:
+      /* any other expression is evaluated and thrown away */
+      reg = compiler_allocate_register (c);
+      compiler_compile_expression (c, handle, reg);
+      compiler_free_registers (c, reg);
+      break;
+    }
+}
+
+void
+compiler_compile_expression (struct Compiler *c,
+                             ASTHandle handle,
+                             unsigned int dest)
+{
+  struct AST *node = ast_get_node (handle);
+  switch (node->type)
+    {
+    case AST_INTEGER:
+      {
+        AmpValue obj = AmpNumberCreate (node->d.int_data.value);
+        compiler_emit (c, INS_ABX (OP_LOAD_CONST,
+                                   dest,
+                                   compiler_add_constant (c, obj)));
+      }
+      break;
+    case AST_STRING:
+      {
+        AmpValue obj = AmpStringCreate (node->d.str_data.str);
+        compiler_emit (c, INS_ABX (OP_LOAD_CONST,
+                                   dest,
+                                   compiler_add_constant (c, obj)));
+      }
+      break;
+    case AST_BOOL:
+      {
+        AmpValue obj = AmpBoolCreate (node->d.bool_data.value);
+        compiler_emit (c, INS_ABX (OP_LOAD_CONST,
+                                   dest,
+                                   compiler_add_constant (c, obj)));
+      }
+      break;
+    case AST_IDENTIFIER:
+      if (node->d.id_data.loc.global)
+        compiler_emit (c, INS_ABX (OP_GET_GLOBAL,
+                                   dest,
+                                   node->d.id_data.loc.slot));
+      else
+        compiler_emit (c, INS_ABC (OP_GET_LOCAL,
+                                   dest,
+                                   compiler_local_register (c,
+                                                            &node->d.id_data.loc),
+                                   0));
+      break;
+    case AST_BINARY_OP:
+      {
+        ASTHandle lhs = node->d.bop_data.left;
+        ASTHandle rhs = node->d.bop_data.right;
+        TValue op = node->d.bop_data.op;
+        unsigned int rhs_reg;
+        OpCode code;
+
+        compiler_compile_expression (c, lhs, dest);
+        rhs_reg = compiler_allocate_register (c);
+        compiler_compile_expression (c, rhs, rhs_reg);
+        switch (op)
+          {
+          case '+': code = OP_ADD; break;
+          case '-': code = OP_SUB; break;
+          case '*': code = OP_MUL; break;
+          case '/': code = OP_DIV; break;
+          default: printf ("Invalid binary operation\n");
+                   exit (1);
+          }
+        compiler_emit (c, INS_ABC (code, dest, dest, rhs_reg));
+        compiler_free_registers (c, rhs_reg);
+      }
+      break;
+    case AST_BINARY_COMPARATOR:
+      {
+        unsigned int rhs_reg;
+        OpCode code = OP_EQUAL;
+
+        compiler_compile_expression (c, node->d.bcmp_data.left, dest);
+        rhs_reg = compiler_allocate_register (c);
+        compiler_compile_expression (c, node->d.bcmp_data.right, rhs_reg);
+        switch (node->d.bcmp_data.type)
+          {
+          case BOP_EQUAL: code = OP_EQUAL; break;
+          case BOP_NOT_EQUAL: code = OP_NOT_EQUAL; break;
+          case BOP_LESS_THAN: code = OP_LESS_THAN; break;
+          case BOP_GREATER_THAN: code = OP_GREATER_THAN; break;
+          }
+        compiler_emit (c, INS_ABC (code, dest, dest, rhs_reg));
+        compiler_free_registers (c, rhs_reg);
+      }
+      break;
+    case AST_FUNC_CALL:
+      compiler_compile_call (c, handle, dest);
+      break;
+    case AST_LIST:
+      compiler_compile_list (c, handle, dest);
+      break;
+    default:
+      printf ("Unhandled expression\n");
+      exit (EXIT_FAILURE);
+    }
+}
+
+void
+compiler_compile_if (struct Compiler *c, ASTHandle handle)
+{
+  struct AST *node = ast_get_node (handle);
+  ASTHandle scope_if_true = node->d.if_data.scope_if_true;
+  ASTHandle scope_if_false = node->d.if_data.scope_if_false;
+  unsigned int reg = compiler_allocate_register (c);
+  unsigned int jump_to_false;
+
+  compiler_compile_expression (c, node->d.if_data.expr, reg);
+  compiler_free_registers (c, reg);
+  compiler_emit (c, INS_ABC (OP_TEST, reg, 0, 0));
+  jump_to_false = compiler_emit (c, INS_SAX_ENCODE (OP_JUMP, 0));
+
+  compiler_compile_block (c, scope_if_true);
+  if (scope_if_false)
+    {
+      unsigned int jump_to_end = compiler_emit (c, INS_SAX_ENCODE (OP_JUMP, 0));
+      compiler_patch_jump (c, jump_to_false);
+      compiler_compile_block (c, scope_if_false);
+      compiler_patch_jump (c, jump_to_end);
+    }
+  else
+    {
+      compiler_patch_jump (c, jump_to_false);
+    }
+}
+
+void
+compiler_compile_loop (struct Compiler *c, ASTHandle handle)
+{
+  struct AST *node = ast_get_node (handle);
+  ASTHandle expr = node->d.while_data.expr;
+  ASTHandle scope = node->d.while_data.scope;
+  ASTHandle step = 0;
+  unsigned int reg;
+  unsigned int loop_start;
+  unsigned int jump_to_end;
+
+  if (node->type == AST_FOR)
+    {
+      if (node->d.for_data.init)
+        compiler_compile_statement (c, node->d.for_data.init);
+      expr = node->d.for_data.expr;
+      scope = node->d.for_data.scope;
+      step = node->d.for_data.step;
+    }
+
+  loop_start = ARRAY_COUNT (c->function->code);
+  reg = compiler_allocate_register (c);
+  compiler_compile_expression (c, expr, reg);
+  compiler_free_registers (c, reg);
+  compiler_emit (c, INS_ABC (OP_TEST, reg, 0, 0));
+  jump_to_end = compiler_emit (c, INS_SAX_ENCODE (OP_JUMP, 0));
+
+  /* the body's registers are the same every iteration,
+   * entering it only unassigns them */
+  compiler_compile_block (c, scope);
+  if (step)
+    compiler_compile_statement (c, step);
+  compiler_emit (c, INS_SAX_ENCODE (OP_JUMP,
+                                    (int) loop_start
+                                      - (int) ARRAY_COUNT (c->function->code)
+                                      - 1));
+  compiler_patch_jump (c, jump_to_end);
+}
+
+void
+compiler_compile_return (struct Compiler *c, ASTHandle handle)
+{
+  struct AST *node = ast_get_node (handle);
+  ASTHandle *args = node->d.func_call_data.args;
+  size_t arg_count = ARRAY_COUNT (args);
+  unsigned int reg;
+
+  if (arg_count == 0)
+    {
+      compiler_emit (c, INS_ABC (OP_RETURN, 0, 0, 0));
+      return;
+    }
+  if (arg_count != 1)
+    {
+      printf (ample_error_codes[ERROR_INVALID_NUMBER_OF_ARGUMENTS],
+              "return",
+              1,
+              (unsigned int) arg_count);
+      exit (1);
+    }
+  reg = compiler_allocate_register (c);
+  compiler_compile_expression (c, args[0], reg);
+  compiler_emit (c, INS_ABC (OP_RETURN, reg, 1, 0));
+  compiler_free_registers (c, reg);
+}
+
+void
+compiler_compile_call (struct Compiler *c, ASTHandle handle, unsigned int dest)
+{
+  struct AST *node = ast_get_node (handle);
+  ASTHandle *args = node->d.func_call_data.args;
+  size_t arg_count = ARRAY_COUNT (args);
+  struct CallSite site;
+  size_t site_index;
+  size_t i;
+
+  /* arguments are evaluated into consecutive registers starting at dest,
+   * the return value replaces the first one */
+  for (i = 0; i < arg_count; i++)
+    {
+      unsigned int reg = i == 0 ? dest : compiler_allocate_register (c);
+      compiler_compile_expression (c, args[i], reg);
+    }
+  compiler_free_registers (c, dest + 1);
+
+  /* taken after the arguments, they can contain calls of their own */
+  site_index = ARRAY_COUNT (c->function->call_sites);
+  if (site_index > INS_MAX_BX)
+    {
+      printf ("Too many function calls in function \"%s\"\n",
+              BytecodeFunctionName (c->function));
+      exit (1);
+    }
+  site.name = compiler_add_name (c, node->d.func_call_data.name);
+  site.arg_count = arg_count;
+  site.builtin = node->d.func_call_data.builtin;
+  site.tail = node->d.func_call_data.tail;
+  site.cached_callee = NULL;
+  site.generation = 0;
+  ARRAY_PUSH (c->function->call_sites, site);
+  /* the instructions after a tail call are still needed when
+   * it calls a builtin */
+  compiler_emit (c, INS_ABX (site.tail ? OP_TAIL_CALL : OP_CALL,
+                             dest,
+                             site_index));
+}
+
+void
+compiler_compile_list (struct Compiler *c, ASTHandle handle, unsigned int dest)
+{
+  struct AST *node = ast_get_node (handle);
+  ASTHandle *items = node->d.list_data.items;
+  size_t item_count = ARRAY_COUNT (items);
+  size_t i = 0;
+  OpCode code = OP_LIST;
+
+  do
+    {
+      /* items are put into the list in batches to keep
+       * the amount of registers needed bounded */
+      unsigned int first = dest + 1;
+      unsigned int count = 0;
+      while (i < item_count && count < COMPILER_LIST_BATCH)
+        {
+          unsigned int reg = compiler_allocate_register (c);
+          compiler_compile_expression (c, items[i], reg);
+          count++;
+          i++;
+        }
+      compiler_emit (c, INS_ABC (code, dest, first, count));
+      compiler_free_registers (c, first);
+      code = OP_APPEND;
+    }
+  while (i < item_count);
+}
+
+struct BytecodeFunction *
+compiler_compile_function (ASTHandle handle, Symbol *globals)
+{
+  struct AST *node = ast_get_node (handle);
+  struct Compiler c = { 0 };
+  ASTHandle *args = node->d.func_data.args;
+  Symbol *locals = node->d.func_data.locals;
+  size_t i;
+
+  c.function = BytecodeFunctionCreate (node->d.func_data.name);
+  c.function->globals = globals;
+  for (i = 0; i < ARRAY_COUNT (args); i++)
+    {
+      ARRAY_PUSH (c.function->params, ast_get_node (args[i])->d.id_data.id);
+    }
+  /* the function's variables are its first registers */
+  for (i = 0; i < ARRAY_COUNT (locals); i++)
+    {
+      compiler_allocate_register (&c);
+    }
+  c.function->local_count = c.free_register;
+  ARRAY_PUSH (c.scope_bases, 0);
+
+  compiler_compile_statements (&c, node->d.func_data.scope);
+  compiler_emit (&c, INS_ABC (OP_RETURN, 0, 0, 0));
+  compiler_add_local_names (&c, locals, 0, 0);
+  ARRAY_FREE (c.scope_bases);
+  return c.function;
+}
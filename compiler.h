@@ -0,0 +1,81 @@
+/*
+    This file is part of Ample.
+
+    Ample is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ample is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ample.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef COMPILER_H_
+#define COMPILER_H_
+#include "ast.h"
+#include "bytecode.h"
+/* ******************
+   External functions
+   ****************** */
+/* compiles the global scope returned by ParseTokens.
+ * Free the result with BytecodeFunctionFree */
+struct BytecodeFunction *CompileProgram(ASTHandle head);
+
+/* ******************
+   Internal Functions
+   ****************** */
+struct Compiler {
+  struct BytecodeFunction *function;
+  unsigned int free_register;
+  /* the register holding slot 0 of each scope that
+   * can be seen from the code being compiled, innermost last */
+  unsigned int *scope_bases; /* array */
+};
+
+unsigned int compiler_emit(struct Compiler *c, Instruction ins);
+/* fills in the offset of a previously emitted jump so it lands
+ * on the next instruction that will be emitted */
+void compiler_patch_jump(struct Compiler *c, unsigned int jump_index);
+unsigned int compiler_allocate_register(struct Compiler *c);
+void compiler_free_registers(struct Compiler *c, unsigned int first);
+unsigned int compiler_add_constant(struct Compiler *c, AmpValue obj);
+unsigned int compiler_add_name(struct Compiler *c, Symbol name);
+
+/* the register a resolved local variable lives in */
+unsigned int compiler_local_register(struct Compiler *c,
+                                     const struct VarLocation *loc);
+/* records which registers hold the named variables
+ * from instruction start up to the current one */
+void compiler_add_local_names(struct Compiler *c,
+                              Symbol *names,
+                              unsigned int first_register,
+                              unsigned int start);
+
+void compiler_compile_statements(struct Compiler *c, ASTHandle scope_handle);
+/* compiles an if/else or loop body, its variables get registers
+ * of their own */
+void compiler_compile_block(struct Compiler *c, ASTHandle scope_handle);
+void compiler_compile_statement(struct Compiler *c, ASTHandle handle);
+/* leaves the value of the expression in register dest.
+ * dest has to be the highest allocated register */
+void compiler_compile_expression(struct Compiler *c,
+                                 ASTHandle handle,
+                                 unsigned int dest);
+void compiler_compile_if(struct Compiler *c, ASTHandle handle);
+/* while and for loops, the test is at the top and the
+ * end of the body jumps back to it */
+void compiler_compile_loop(struct Compiler *c, ASTHandle handle);
+void compiler_compile_return(struct Compiler *c, ASTHandle handle);
+void compiler_compile_call(struct Compiler *c,
+                           ASTHandle handle,
+                           unsigned int dest);
+void compiler_compile_list(struct Compiler *c,
+                           ASTHandle handle,
+                           unsigned int dest);
+struct BytecodeFunction *compiler_compile_function(ASTHandle handle,
+                                                   Symbol *globals);
+#endif
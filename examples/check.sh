@@ -0,0 +1,64 @@
+#!/bin/sh
+#    This file is part of Ample.
+#
+#    Ample is free software: you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation, either version 3 of the License, or
+#    (at your option) any later version.
+#
+#    Ample is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with Ample.  If not, see <https://www.gnu.org/licenses/>.
+
+# Runs every example that has a .expected file next to it and compares
+# what it prints with that file. Each one runs on the bytecode vm, on
+# the tree walker and through the syntax tree cache, once when the
+# cache is stale and once when it's used. A "# args:" line in an
+# example gives it extra options. The total allocated memory differs
+# between the engines, so that line isn't compared.
+#
+# usage: examples/check.sh path/to/ample
+ample=$1
+if [ -z "$ample" ]; then
+  echo "usage: $0 path/to/ample"
+  exit 2
+fi
+examples=$(dirname "$0")
+scratch=$(mktemp -d)
+trap 'rm -rf "$scratch"' EXIT
+failed=0
+count=0
+
+# run label expected-file ample-arguments...
+run () {
+  run_label=$1
+  run_expected=$2
+  shift 2
+  "$ample" "$@" 2>&1 | grep -v '^Total allocated memory' > "$scratch/out"
+  if ! diff "$run_expected" "$scratch/out" > "$scratch/diff"; then
+    echo "FAIL $run_label"
+    head -20 "$scratch/diff"
+    failed=$((failed + 1))
+  fi
+  count=$((count + 1))
+}
+
+for expected in "$examples"/*.expected; do
+  script=${expected%.expected}.ample
+  name=$(basename "$script")
+  args=$(sed -n 's/^# args: //p' "$script" | head -1)
+  # every example is copied to the same name, so the cache
+  # the one before left behind is stale
+  cp "$script" "$scratch/script.ample"
+  run "$name" "$expected" $args "$script"
+  run "$name --tree-walker" "$expected" $args --tree-walker "$script"
+  run "$name --cache (stale)" "$expected" $args --cache "$scratch/script.ample"
+  run "$name --cache" "$expected" $args --cache "$scratch/script.ample"
+done
+
+echo "$((count - failed)) of $count runs passed"
+[ "$failed" -eq 0 ]
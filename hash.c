@@ -39,6 +39,22 @@ hash_sizet(size_t x)
 }
 
 
+/* FNV-1a over length bytes, str doesn't need to be NUL terminated.
+ * Every byte reaches the low bits, so a table can be indexed by them */
+size_t
+hash_bytes (const char *str, size_t length)
+{
+  const unsigned char *us = (const unsigned char *) str;
+  size_t h = 2166136261u;
+  size_t i;
+  for (i = 0; i < length; i++)
+    {
+      h ^= us[i];
+      h *= 16777619u;
+    }
+  return h;
+}
+
 bool32
 string_compare (const char *key, const char *input)
 {
@@ -51,6 +67,20 @@ int_compare (int key, int input)
   return (key == input);
 }
 
+/* for keys that are dense ids, they spread over
+ * the buckets without any mixing */
+size_t
+hash_uint (unsigned int num)
+{
+  return num;
+}
+
+bool32
+uint_compare (unsigned int key, unsigned int input)
+{
+  return (key == input);
+}
+
 bool32
 sizet_compare (size_t key, size_t input)
 {
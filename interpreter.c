@@ -18,7 +18,8 @@
 #include "ample_errors.h"
 #include "bool.h"
 #include "array.h"
-#include "dict_vars.h"
+#include "stack.h"
+#include "hash.h"
 #include "objects/ampobject.h"
 #include "objects/numobject.h"
 #include "objects/boolobject.h"
@@ -28,196 +29,394 @@
 
 #include <assert.h>
 #include <string.h>
-static DICT(ObjVars) global_variables;
-DICT_DECLARE (Func, const char *, ASTHandle);
-DICT_IMPL (Func, const char *, ASTHandle)
-#define DEFUALT_DICT_INIT_COUNT 1
+/* the variables of every live scope, each scope's frame owns
+ * the slots from its base up to the next frame's base.
+ * the global scope's frame starts at 0 */
+static AmpValue *interpreter_slots;
+static size_t interpreter_slot_count;
+static size_t interpreter_slot_capacity;
+static struct InterpreterFrame *interpreter_frames; /* array */
+STACK_DECLARATION (InterpreterTask, struct InterpreterTask);
+STACK_DECLARATION (AmpValue, AmpValue);
+static STACK (InterpreterTask) interpreter_tasks;
+static STACK (AmpValue) interpreter_values;
+static size_t interpreter_stack_limit;
+DICT_DECLARE (Func, Symbol, ASTHandle);
+DICT_IMPL (Func, Symbol, ASTHandle)
 static DICT(Func) func_dict;
+/* bumped whenever a function is defined, which is what
+ * invalidates the call caches of the call nodes */
+static unsigned int interpreter_function_generation;
 
 void
-interpreter_erase_variable_if_exists (const char *var,
-                                      DICT (ObjVars) *local_variables)
+InterpreterStart (ASTHandle head, size_t stack_limit)
 {
+  struct AST *head_node = ast_get_node (head);
+  size_t global_frame;
+  if (!head_node)
+    return;
+
+  DictFunc_init (&func_dict, hash_uint, uint_compare, 10);
+  /* a zeroed call node must not look cached */
+  interpreter_function_generation = 1;
+  interpreter_stack_limit = stack_limit;
+  STACK_STRUCT_INIT (InterpreterTask,
+                     &interpreter_tasks,
+                     struct InterpreterTask,
+                     64);
+  STACK_STRUCT_INIT (AmpValue, &interpreter_values, AmpValue, 64);
+  global_frame = interpreter_push_frame (INTERPRETER_NO_FRAME,
+                                         ARRAY_COUNT (head_node->d.scope_data.locals));
 
-  AmpObject *obj = NULL;
-  bool32 success = DictObjVars_get_and_erase (local_variables, var, &obj);
-  if (success)
-    AmpObjectDecrementRefcount (obj);
+  /* evaluate the global scope */
+  interpreter_enter_scope (head, global_frame, true);
+  interpreter_run ();
+  assert (STACK_EMPTY (&interpreter_values));
+
+  interpreter_pop_frame (global_frame);
+  free (interpreter_slots);
+  interpreter_slots = NULL;
+  interpreter_slot_capacity = 0;
+  ARRAY_FREE (interpreter_frames);
+  interpreter_frames = NULL;
+  STACK_FREE (&interpreter_tasks, InterpreterTask);
+  STACK_FREE (&interpreter_values, AmpValue);
+  DictFunc_free (&func_dict);
 }
 
 void
-interpreter_add_obj_mapping (const char *var_name,
-                             AmpObject *obj,
-                             DICT (ObjVars) *local_variables)
+interpreter_run (void)
 {
-  interpreter_erase_variable_if_exists (var_name, local_variables);
-  DictObjVars_insert (local_variables, var_name, obj);
+  while (!STACK_EMPTY (&interpreter_tasks))
+    {
+      struct InterpreterTask *top = &STACK_FRONT (&interpreter_tasks);
+      struct InterpreterTask task;
+      if (top->type == TASK_RUN_SCOPE)
+        {
+          struct AST *scope = ast_get_node (top->node);
+          ASTHandle *statements = scope->d.scope_data.statements;
+          /* the scope stays on the stack until its last statement ran,
+           * running one can grow the stack so top is done with first */
+          if (top->index < ARRAY_COUNT (statements))
+            {
+              interpreter_run_statement (statements[top->index++],
+                                         top->frame);
+            }
+          else
+            {
+              STACK_POP (&interpreter_tasks);
+            }
+          continue;
+        }
+      task = *top;
+      STACK_POP (&interpreter_tasks);
+      interpreter_run_task (&task);
+    }
 }
 
 void
-InterpreterStart (ASTHandle head)
+interpreter_run_task (const struct InterpreterTask *task)
 {
-  DictFunc_init (&func_dict, hash_string, string_compare, 10);
-  /* evaluate the global scope */
-  bool32 should_return = false;
-  interpreter_evaluate_scope (head, NULL, false, &should_return);
-  DictFunc_free (&func_dict);
+  switch (task->type)
+    {
+    case TASK_EVALUATE:
+      interpreter_evaluate (task->node, task->frame);
+      break;
+    case TASK_RUN_SCOPE:
+      /* only ever run by interpreter_run */
+      assert (false);
+      break;
+    case TASK_LEAVE_SCOPE:
+      interpreter_leave_scope (task);
+      break;
+    case TASK_ENTER_FUNCTION:
+      interpreter_enter_function (task);
+      break;
+    case TASK_LEAVE_FUNCTION:
+      /* the function ended without a return */
+      interpreter_pop_frame (task->frame);
+      interpreter_push_value (AMP_VALUE_EMPTY);
+      break;
+    case TASK_RETURN:
+      interpreter_return ();
+      break;
+    case TASK_CALL_BUILTIN:
+      {
+        struct AST *node = ast_get_node (task->node);
+        const struct AmpleBuiltin *builtin =
+          &AMPLE_BUILTIN_TABLE[node->d.func_call_data.builtin];
+        size_t arg_count = ARRAY_COUNT (node->d.func_call_data.args);
+        /* the arguments are the newest values, in order */
+        AmpValue *args = &interpreter_values.mem[interpreter_values.size
+                                                 - arg_count];
+        AmpValue obj = builtin->function (args);
+        size_t i;
+        for (i = 0; i < arg_count; i++)
+          {
+            AmpValueDecrementRefcount (interpreter_pop_value ());
+          }
+        interpreter_push_value (obj);
+      }
+      break;
+    case TASK_BINARY_OP:
+    case TASK_COMPARE:
+      {
+        AmpValue right = interpreter_pop_value ();
+        AmpValue left = interpreter_pop_value ();
+        if (task->type == TASK_BINARY_OP)
+          interpreter_push_value (interpreter_binary_op (task->node,
+                                                         left,
+                                                         right));
+        else
+          interpreter_push_value (interpreter_compare (task->node,
+                                                       left,
+                                                       right));
+      }
+      break;
+    case TASK_MAKE_LIST:
+      interpreter_push_value (interpreter_make_list (task->node));
+      break;
+    case TASK_ASSIGN:
+      interpreter_assign (task->node, interpreter_pop_value (), task->frame);
+      break;
+    case TASK_BRANCH:
+      {
+        bool32 condition = interpreter_pop_condition ();
+        interpreter_branch (task->node, condition, task->frame);
+      }
+      break;
+    case TASK_LOOP:
+      interpreter_loop_test (task);
+      break;
+    case TASK_LOOP_TEST:
+      {
+        bool32 condition = interpreter_pop_condition ();
+        interpreter_loop_iterate (task, condition);
+      }
+      break;
+    case TASK_LOOP_STEP:
+      interpreter_run_statement (ast_get_node (task->node)->d.for_data.step,
+                                 task->frame);
+      break;
+    case TASK_DISCARD:
+      {
+        AmpValue obj = interpreter_pop_value ();
+        if (!AMP_VALUE_IS_EMPTY (obj))
+          AmpValueDecrementRefcount (obj);
+      }
+      break;
+    }
 }
 
-AmpObject *
-interpreter_evaluate_statement (ASTHandle statement,
-                                DICT (ObjVars) **variable_scope_stack,
-                                bool32 *return_from_scope)
+void
+interpreter_push_task (InterpreterTaskType type, ASTHandle node, size_t frame)
+{
+  struct InterpreterTask task;
+  interpreter_init_task (&task, type, node, frame);
+  STACK_PUSH (&interpreter_tasks, task);
+}
+
+void
+interpreter_init_task (struct InterpreterTask *task,
+                       InterpreterTaskType type,
+                       ASTHandle node,
+                       size_t frame)
+{
+  task->type = type;
+  task->node = node;
+  task->target = 0;
+  task->index = 0;
+  task->frame = frame;
+}
+
+AmpValue
+interpreter_pop_value (void)
+{
+  AmpValue value = STACK_FRONT (&interpreter_values);
+  STACK_POP (&interpreter_values);
+  return value;
+}
+
+void
+interpreter_push_value (AmpValue value)
+{
+  STACK_PUSH (&interpreter_values, value);
+}
+
+void
+interpreter_run_statement (ASTHandle statement, size_t frame)
 {
   struct AST *s = ast_get_node (statement);
+  struct InterpreterTask then;
   switch (s->type)
     {
     case AST_ASSIGNMENT:
-      interpreter_evaluate_assignment (statement, variable_scope_stack);
+      interpreter_init_task (&then, TASK_ASSIGN, statement, frame);
+      interpreter_evaluate_then (&then, &s->d.asgn_data.expr, 1);
       break;
     case AST_BINARY_OP:
-      return interpreter_evaluate_binary_op (statement, variable_scope_stack);
+    case AST_BINARY_COMPARATOR:
+    case AST_LIST:
+      /* the value is thrown away, but evaluating it can still fail */
+      interpreter_init_task (&then, TASK_DISCARD, statement, frame);
+      interpreter_evaluate_then (&then, &statement, 1);
       break;
     case AST_IF:
-      return interpreter_evaluate_if (statement,
-                                      variable_scope_stack,
-                                      return_from_scope);
+      {
+        bool32 condition;
+        if (interpreter_condition_is_ready (s->d.if_data.expr,
+                                            frame,
+                                            &condition))
+          {
+            interpreter_branch (statement, condition, frame);
+          }
+        else
+          {
+            interpreter_init_task (&then, TASK_BRANCH, statement, frame);
+            interpreter_evaluate_then (&then, &s->d.if_data.expr, 1);
+          }
+      }
       break;
-    case AST_BINARY_COMPARATOR:
-      return interpreter_evaluate_binary_comparison (statement,
-                                                     variable_scope_stack);
+    case AST_WHILE:
+    case AST_FOR:
+      interpreter_start_loop (statement, frame);
       break;
     case AST_FUNC:
       interpreter_insert_function_into_dict (statement);
       break;
     case AST_FUNC_CALL:
-      return interpreter_evaluate_function_call (statement,
-                                                 variable_scope_stack,
-                                                 return_from_scope);
+      interpreter_push_task (TASK_DISCARD, statement, frame);
+      interpreter_call (statement, frame, true);
       break;
     case AST_INTEGER:
-      return AmpNumberCreate (s->d.int_data.value);
-      break;
     case AST_STRING:
-      return AmpStringCreate (s->d.str_data.str);
-      break;
     case AST_BOOL:
-      return AmpBoolCreate (s->d.bool_data.value);
-      break;
     case AST_IDENTIFIER:
-      return interpreter_find_variable (s->d.id_data.id,
-                                        variable_scope_stack);
-      break;
-    case AST_LIST:
-      return interpreter_evaluate_list (statement,
-                                        variable_scope_stack,
-                                        return_from_scope);
+      /* a lone literal or variable has no effect */
       break;
     default:
       printf ("Unhandled statement\n");
       exit (EXIT_FAILURE);
     }
-  return NULL;
 }
 
-AmpObject *
-interpreter_evaluate_list (ASTHandle statement,
-                           DICT (ObjVars) **restrict variable_scope_stack,
-                           bool32 *return_from_scope)
+bool32
+interpreter_evaluate_leaf (ASTHandle handle, size_t frame)
 {
-  struct AST *s = ast_get_node (statement);
-  ASTHandle *items = s->d.list_data.items;
-  AmpObject **objects = NULL;
-  for (size_t i = 0; i < ARRAY_COUNT (items); i++)
+  struct AST *node = ast_get_node (handle);
+  AmpValue obj;
+  switch (node->type)
     {
-      AmpObject *obj = interpreter_evaluate_statement (items[i],
-                                                       variable_scope_stack,
-                                                       return_from_scope);
-      ARRAY_PUSH (objects, obj);
+    case AST_IDENTIFIER:
+      obj = interpreter_get_amp_object (&node->d.id_data, frame);
+      AmpValueIncrementRefcount (obj);
+      break;
+    case AST_INTEGER:
+      obj = AmpNumberCreate (node->d.int_data.value);
+      break;
+    case AST_STRING:
+      obj = AmpStringCreate (node->d.str_data.str);
+      break;
+    case AST_BOOL:
+      obj = AmpBoolCreate (node->d.bool_data.value);
+      break;
+    default:
+      return false;
     }
-  return AmpListCreate (objects);
+  interpreter_push_value (obj);
+  return true;
 }
 
-AmpObject *
-interpreter_find_variable (const char *var,
-                           DICT (ObjVars) **variable_scope_stack)
+void
+interpreter_evaluate (ASTHandle handle, size_t frame)
 {
-  /* make sure that the variable doesn't already exist in a parent scope */
-  size_t i = 0;
-  AmpObject *obj = NULL;
-  for (i = 0; i < ARRAY_COUNT (variable_scope_stack); i++)
+  struct AST *node;
+  struct InterpreterTask then;
+  ASTHandle operands[2];
+  if (interpreter_evaluate_leaf (handle, frame))
+    return;
+  node = ast_get_node (handle);
+  switch (node->type)
     {
-      bool32 exists_in_scope = DictObjVars_get (variable_scope_stack[i],
-                                                var,
-                                                &obj);
-      if (exists_in_scope)
-        return obj;
+    case AST_BINARY_OP:
+      operands[0] = node->d.bop_data.left;
+      operands[1] = node->d.bop_data.right;
+      interpreter_init_task (&then, TASK_BINARY_OP, handle, frame);
+      interpreter_evaluate_then (&then, operands, 2);
+      break;
+    case AST_BINARY_COMPARATOR:
+      operands[0] = node->d.bcmp_data.left;
+      operands[1] = node->d.bcmp_data.right;
+      interpreter_init_task (&then, TASK_COMPARE, handle, frame);
+      interpreter_evaluate_then (&then, operands, 2);
+      break;
+    case AST_LIST:
+      interpreter_init_task (&then, TASK_MAKE_LIST, handle, frame);
+      interpreter_evaluate_then (&then,
+                                 node->d.list_data.items,
+                                 ARRAY_COUNT (node->d.list_data.items));
+      break;
+    case AST_FUNC_CALL:
+      interpreter_call (handle, frame, false);
+      break;
+    default:
+      assert (false);
+      break;
     }
-  return obj;
 }
 
-DICT (ObjVars) **
-interpreter_create_new_variable_scope_stack (DICT (ObjVars) *local_variables,
-                                             DICT (ObjVars) **var_scope_stack)
+void
+interpreter_evaluate_then (const struct InterpreterTask *then,
+                           ASTHandle *nodes,
+                           size_t count)
 {
-  size_t i;
-  DICT (ObjVars) **new_variable_scope_stack = NULL;
-  /* the local variables will be at index 0 */
-  ARRAY_PUSH (new_variable_scope_stack, local_variables);
-  if (var_scope_stack)
+  size_t i = 0;
+  while (i < count && interpreter_evaluate_leaf (nodes[i], then->frame))
     {
-      size_t arr_size = ARRAY_COUNT (var_scope_stack);
-      for (i = 0; i < arr_size; i++)
-        {
-          ARRAY_PUSH (new_variable_scope_stack, var_scope_stack[i]); 
-        }
+      i++;
     }
-
-  return new_variable_scope_stack;
-}
-
-void
-interpreter_free_local_variables (DICT (ObjVars) *local_variables)
-{
-  size_t i;
-  for (i = 1; i < ARRAY_COUNT (local_variables->mem); i++)
+  if (i == count)
+    {
+      /* every value is there already */
+      interpreter_run_task (then);
+      return;
+    }
+  STACK_PUSH (&interpreter_tasks, *then);
+  /* pushed backwards so they run front to back, the first one
+   * would be the next task to run so it starts right away */
+  while (count > i + 1)
     {
-      AmpObjectDecrementRefcount (local_variables->mem[i].val);
+      count--;
+      interpreter_push_task (TASK_EVALUATE, nodes[count], then->frame);
     }
-  DictObjVars_free (local_variables);
-  free (local_variables);
+  interpreter_evaluate (nodes[i], then->frame);
 }
 
-AmpObject *
-interpreter_evaluate_function_call (ASTHandle func_call,
-                                    DICT (ObjVars) **variable_scope_stack,
-                                    bool32 *return_from_scope)
+void
+interpreter_call (ASTHandle func_call, size_t frame, bool32 statement)
 {
   ASTHandle func_handle;
-  bool32 user_defined_function;
   struct AST *func_call_node = ast_get_node (func_call);
-  const char *func_name = func_call_node->d.func_call_data.name;
+  struct FuncCallAST *call = &func_call_node->d.func_call_data;
+  size_t arg_input_count = ARRAY_COUNT (call->args);
+  struct InterpreterTask then;
+  const char *func_name;
 
-  /* try to find the func definition */
-  user_defined_function = DictFunc_get (&func_dict,
-                                               func_name,
-                                               &func_handle);
-  if (user_defined_function)
+  /* the cached target is good until the next function definition */
+  if (call->generation != interpreter_function_generation)
+    {
+      if (!DictFunc_get (&func_dict, call->name, &func_handle))
+        func_handle = 0;
+      call->cached_func = func_handle;
+      call->generation = interpreter_function_generation;
+    }
+  func_handle = call->cached_func;
+  func_name = SymbolName (call->name);
+  if (func_handle)
     {
       /* execute a user defined function */
-      /* copy args to a local scope */
-      DICT(ObjVars) *local_variables = malloc (sizeof (DICT (ObjVars)));
-      DICT (ObjVars) **new_variable_scope_stack = NULL;
       struct AST *func_node = ast_get_node (func_handle);
-      ASTHandle *args = func_node->d.func_data.args;
-      ASTHandle *args_input = func_call_node->d.func_call_data.args;
-      size_t arg_count = ARRAY_COUNT (args);
-      size_t arg_input_count = ARRAY_COUNT (args_input);
-      size_t i;
-      DictObjVars_init (local_variables,
-                        hash_string,
-                        string_compare,
-                        DEFUALT_DICT_INIT_COUNT);
+      size_t arg_count = ARRAY_COUNT (func_node->d.func_data.args);
 
       if (arg_count != arg_input_count)
         {
@@ -228,439 +427,570 @@ interpreter_evaluate_function_call (ASTHandle func_call,
                   (unsigned int) arg_input_count);
           exit (1);
         }
-      for (i = 0; i < arg_count; i++)
+      /* the function is remembered since evaluating the arguments
+       * can define functions */
+      interpreter_init_task (&then, TASK_ENTER_FUNCTION, func_call, frame);
+      then.target = func_handle;
+      interpreter_evaluate_then (&then, call->args, arg_input_count);
+    }
+  else if (call->builtin == AMPLE_BUILTIN_RETURN && statement)
+    {
+      if (arg_input_count == 0)
         {
-          struct AST *arg = ast_get_node (args[i]);
-          if (arg->type == AST_IDENTIFIER)
-            {
-              AmpObject *obj =
-                InterpreterGetOrGenerateAmpObject (args_input[i],
-                                                   variable_scope_stack);
-              DictObjVars_insert (local_variables, arg->d.id_data.id, obj);
-            }
-          else
-            {
-              printf ("Function arg specifiers should be identifier\n");
-              exit (1);
-            }
+          interpreter_push_value (AMP_VALUE_EMPTY);
+          interpreter_return ();
+          return;
         }
-      new_variable_scope_stack =
-        interpreter_create_new_variable_scope_stack (local_variables,
-                                                     variable_scope_stack);
-
-      /* this will free the local scope upon finishing */
-      bool32 should_return = false;
-      if (return_from_scope)
-        return interpreter_evaluate_scope (func_node->d.func_data.scope,
-                                           new_variable_scope_stack,
-                                           true,
-                                           return_from_scope);
-      else
-        return interpreter_evaluate_scope (func_node->d.func_data.scope,
-                                           new_variable_scope_stack,
-                                           true,
-                                           &should_return);
+      ample_function_check_arg_numbers (arg_input_count, 1, func_name);
+      interpreter_init_task (&then, TASK_RETURN, func_call, frame);
+      interpreter_evaluate_then (&then, call->args, 1);
+    }
+  else if (call->builtin != AMPLE_BUILTIN_NONE
+           && call->builtin != AMPLE_BUILTIN_RETURN)
+    {
+      const struct AmpleBuiltin *builtin = &AMPLE_BUILTIN_TABLE[call->builtin];
+      ample_function_check_arg_numbers (arg_input_count,
+                                        builtin->arg_count,
+                                        builtin->name);
+      interpreter_init_task (&then, TASK_CALL_BUILTIN, func_call, frame);
+      interpreter_evaluate_then (&then, call->args, arg_input_count);
     }
   else
     {
-      ASTHandle *args_input = func_call_node->d.func_call_data.args;
-      size_t arg_count = ARRAY_COUNT (args_input);
-      AmpObject *obj;
-      if (!ExecuteAmpleFunction (args_input,
-                                 arg_count,
-                                 func_name,
-                                 variable_scope_stack,
-                                 &obj,
-                                 return_from_scope))
-        {
-          printf ("Function does not exist: %s\n",
-                  func_call_node->d.func_call_data.name);
-          exit (1);
-        }
-      if (obj)
-        return obj;
+      printf ("Function does not exist: %s\n", func_name);
+      exit (1);
     }
-  return NULL;
 }
 
 void
-interpreter_insert_function_into_dict (ASTHandle func_handle)
+interpreter_enter_function (const struct InterpreterTask *task)
 {
-  const char *func_name = ast_get_node (func_handle)->d.func_data.name;
-  DictFunc_insert (&func_dict, func_name, func_handle);
+  struct AST *func_node = ast_get_node (task->target);
+  size_t arg_count = ARRAY_COUNT (func_node->d.func_data.args);
+  AmpValue *args;
+  size_t new_frame;
+  bool32 tail_call;
+  size_t i;
+
+  /* a tail call takes over the frame of the function making it,
+   * so recursing this way runs in constant memory */
+  tail_call = interpreter_leave_for_tail_call (task->node);
+  /* a function only sees its own variables and the globals,
+   * so its frame has no parent */
+  new_frame = interpreter_push_frame (INTERPRETER_NO_FRAME,
+                                      ARRAY_COUNT (func_node->d.func_data.locals));
+  /* the arguments are the first slots of the function's scope,
+   * the values move over with their references */
+  args = &interpreter_values.mem[interpreter_values.size - arg_count];
+  for (i = 0; i < arg_count; i++)
+    {
+      interpreter_slots[interpreter_frames[new_frame].base + i] = args[i];
+    }
+  for (i = 0; i < arg_count; i++)
+    {
+      STACK_POP (&interpreter_values);
+    }
+  if (!tail_call)
+    {
+      interpreter_check_stack_limit ();
+      interpreter_push_task (TASK_LEAVE_FUNCTION, task->node, new_frame);
+    }
+  interpreter_enter_scope (func_node->d.func_data.scope, new_frame, true);
 }
 
-AmpObject *
-interpreter_evaluate_binary_comparison (ASTHandle binary_comparison_handle,
-                               DICT (ObjVars) **variable_scope_stack)
+bool32
+interpreter_leave_for_tail_call (ASTHandle func_call)
 {
-  struct AST *binary_comparison_ast = ast_get_node (binary_comparison_handle);
-    /* get amp objects to work with */
-  AmpObject *left_obj =
-    InterpreterGetOrGenerateAmpObject
-      (binary_comparison_ast->d.bcmp_data.left,
-       variable_scope_stack);
-  AmpObject *right_obj =
-    InterpreterGetOrGenerateAmpObject
-      (binary_comparison_ast->d.bcmp_data.right,
-       variable_scope_stack);
-  AmpObject *retval = NULL;
-
+  struct FuncCallAST *call = &ast_get_node (func_call)->d.func_call_data;
+  struct InterpreterTask *top;
+  if (call->tail == CALL_TAIL_NONE || STACK_EMPTY (&interpreter_tasks))
+    return false;
+  /* the statement the call is in has to be what runs next, a "return"
+   * that is a user defined function isn't a return */
+  top = &STACK_FRONT (&interpreter_tasks);
+  if (call->tail == CALL_TAIL_STATEMENT && top->type != TASK_DISCARD)
+    return false;
+  if (call->tail == CALL_TAIL_RETURN && top->type != TASK_RETURN)
+    return false;
+
+  /* what is left are the ends of the scopes around the call */
+  for (;;)
+    {
+      top = &STACK_FRONT (&interpreter_tasks);
+      if (top->type == TASK_LEAVE_FUNCTION)
+        break;
+      assert (top->type == TASK_DISCARD
+              || top->type == TASK_RETURN
+              || top->type == TASK_RUN_SCOPE
+              || top->type == TASK_LEAVE_SCOPE
+              || top->type == TASK_LOOP
+              || top->type == TASK_LOOP_STEP);
+      if (top->type == TASK_LEAVE_SCOPE)
+        interpreter_leave_scope (top);
+      STACK_POP (&interpreter_tasks);
+    }
+  /* the caller's leave task is the callee's now. Once a call in the
+   * chain drops its value the first caller returns nothing */
+  if (call->tail == CALL_TAIL_STATEMENT)
+    top->index = true;
+  /* the arguments are on the value stack, so the frame can go */
+  interpreter_pop_frame (top->frame);
+  return true;
+}
 
-  if (left_obj->info->type == right_obj->info->type)
+void
+interpreter_return (void)
+{
+  /* a return inside the function only ends the function, everything
+   * that's left of the scopes it is in is dropped */
+  while (!STACK_EMPTY (&interpreter_tasks))
     {
-      if (binary_comparison_ast->d.bcmp_data.type == BOP_EQUAL)
-        retval = left_obj->info->ops.equal (left_obj, right_obj);
-      else if (binary_comparison_ast->d.bcmp_data.type == BOP_NOT_EQUAL)
-        retval = left_obj->info->ops.not_equal (left_obj, right_obj);
-      else if (binary_comparison_ast->d.bcmp_data.type == BOP_LESS_THAN)
-        retval = left_obj->info->ops.less_than (left_obj, right_obj);
-      else if (binary_comparison_ast->d.bcmp_data.type == BOP_GREATER_THAN)
-        retval = left_obj->info->ops.greater_than (left_obj, right_obj);
+      struct InterpreterTask task = STACK_FRONT (&interpreter_tasks);
+      STACK_POP (&interpreter_tasks);
+      if (task.type == TASK_LEAVE_SCOPE)
+        {
+          interpreter_leave_scope (&task);
+        }
+      else if (task.type == TASK_LEAVE_FUNCTION)
+        {
+          /* the return value stays as the value of the call */
+          interpreter_pop_frame (task.frame);
+          if (task.index)
+            {
+              AmpValueDecrementRefcount (interpreter_pop_value ());
+              interpreter_push_value (AMP_VALUE_EMPTY);
+            }
+          return;
+        }
     }
-  else
+  /* returned from the global scope */
+  AmpValueDecrementRefcount (interpreter_pop_value ());
+}
+
+void
+interpreter_enter_scope (ASTHandle scope_handle, size_t frame, bool32 in_frame)
+{
+  struct AST *scope = ast_get_node (scope_handle);
+  if (!scope)
+    return;
+
+  /* a scope that binds nothing runs in the frame around it */
+  if (!in_frame && scope->d.scope_data.has_frame)
     {
-      printf (ample_error_codes[ERROR_OPERATION_ON_DIFFERENT_TYPES],
-              AMP_OBJECT_TYPE_STR[left_obj->info->type],
-              AMP_OBJECT_TYPE_STR[right_obj->info->type]);
-      exit (1);
+      frame = interpreter_push_frame (frame,
+                                      ARRAY_COUNT (scope->d.scope_data.locals));
+      interpreter_push_task (TASK_LEAVE_SCOPE, scope_handle, frame);
     }
-  AmpObjectDecrementRefcount (left_obj);
-  AmpObjectDecrementRefcount (right_obj);
-  return retval;
+  interpreter_push_task (TASK_RUN_SCOPE, scope_handle, frame);
+}
+
+void
+interpreter_leave_scope (const struct InterpreterTask *task)
+{
+#ifdef INTERPRETER_DEBUG
+  struct AST *scope = ast_get_node (task->node);
+  debug__interpreter_print_all_vars (scope->d.scope_data.locals,
+                                     &interpreter_slots[interpreter_frames[task->frame].base]);
+#endif
+  interpreter_pop_frame (task->frame);
+}
+
+void
+interpreter_branch (ASTHandle if_handle, bool32 condition, size_t frame)
+{
+  struct AST *if_node = ast_get_node (if_handle);
+  /* run different scopes depending on the if's true or false */
+  if (condition)
+    interpreter_enter_scope (if_node->d.if_data.scope_if_true, frame, false);
+  else
+    interpreter_enter_scope (if_node->d.if_data.scope_if_false, frame, false);
 }
 
-AmpObject *
-interpreter_evaluate_statement_to_bool32 (ASTHandle statement_handle,
-                                          DICT (ObjVars) **variable_scope_stack)
+bool32
+interpreter_condition_is_ready (ASTHandle expr_handle,
+                                size_t frame,
+                                bool32 *condition)
 {
-  struct AST *expr = ast_get_node (statement_handle);
+  struct AST *expr = ast_get_node (expr_handle);
   if (expr->type == AST_BOOL)
     {
-      return AmpBoolCreate (expr->d.bool_data.value);
+      *condition = expr->d.bool_data.value;
+      return true;
     }
   else if (expr->type == AST_IDENTIFIER)
     {
       /* assume we are given a pre-existing variable */
-      char *identifier_str = expr->d.id_data.id;
-      AmpObject *obj = interpreter_get_amp_object (identifier_str,
-                                                   variable_scope_stack);
-      if (obj->info->type == AMP_OBJECT_BOOL)
+      AmpValue obj = interpreter_get_amp_object (&expr->d.id_data, frame);
+      if (AMP_VALUE_TYPE (obj) != AMP_OBJECT_BOOL)
         {
-          AmpObjectIncrementRefcount (obj);
-          return obj;
-        }
-      else
-        {
-          printf ("Variable \"%s\" is not of type bool\n", identifier_str);
+          printf ("Variable \"%s\" is not of type bool\n",
+                  SymbolName (expr->d.id_data.id));
           exit (1);
         }
+      *condition = AMP_VALUE_TO_BOOL (obj);
+      return true;
     }
-  else if (expr->type == AST_BINARY_COMPARATOR)
-    {
-      AmpObject *obj = interpreter_evaluate_binary_comparison (statement_handle,
-                                                      variable_scope_stack);
-      return obj;
-    }
-  else
+  /* anything else is evaluated first and tested when it's popped */
+  return false;
+}
+
+bool32
+interpreter_pop_condition (void)
+{
+  AmpValue obj = interpreter_pop_value ();
+  bool32 condition;
+  if (!AMP_VALUE_IS_BOOL (obj))
     {
       printf ("Expression does not evaluate to a bool\n");
       exit (1);
     }
+  condition = AMP_VALUE_TO_BOOL (obj);
+  AmpValueDecrementRefcount (obj);
+  return condition;
 }
 
-AmpObject *
-interpreter_evaluate_scope (ASTHandle scope_handle,
-                            DICT (ObjVars) **variable_scope_stack,
-                            bool32 local_scope_already_created,
-                            bool32 *should_return)
+void
+interpreter_start_loop (ASTHandle loop_handle, size_t frame)
 {
-  struct AST *scope = ast_get_node (scope_handle);
-  if (!scope)
-    { 
-      if (local_scope_already_created)
-        {
-          interpreter_free_local_variables (variable_scope_stack[0]);
-          ARRAY_FREE (variable_scope_stack);
-        }
-      return NULL;
+  struct AST *loop = ast_get_node (loop_handle);
+  struct AST *body = ast_get_node (interpreter_loop_body (loop));
+  struct InterpreterTask task;
+  size_t body_frame = frame;
+
+  /* the body's frame is made once for the whole loop, every
+   * iteration just starts with its variables unassigned */
+  if (body && body->d.scope_data.has_frame)
+    {
+      body_frame = interpreter_push_frame (frame,
+                                           ARRAY_COUNT (body->d.scope_data.locals));
+      interpreter_push_task (TASK_LEAVE_SCOPE,
+                             interpreter_loop_body (loop),
+                             body_frame);
     }
-  /* set up the scope's variable stacks */
-  DICT(ObjVars) **new_variable_scope_stack = NULL;
-  DICT(ObjVars) *local_variables;
-  size_t statement_count;
-  size_t i;
+  interpreter_init_task (&task, TASK_LOOP, loop_handle, frame);
+  task.index = body_frame;
+  STACK_PUSH (&interpreter_tasks, task);
+  if (loop->type == AST_FOR && loop->d.for_data.init)
+    interpreter_run_statement (loop->d.for_data.init, frame);
+}
 
-  if (!local_scope_already_created)
+ASTHandle
+interpreter_loop_body (struct AST *loop)
+{
+  if (loop->type == AST_WHILE)
+    return loop->d.while_data.scope;
+  return loop->d.for_data.scope;
+}
+
+void
+interpreter_loop_test (const struct InterpreterTask *task)
+{
+  struct AST *loop = ast_get_node (task->node);
+  ASTHandle expr = loop->type == AST_WHILE ? loop->d.while_data.expr
+                                           : loop->d.for_data.expr;
+  struct InterpreterTask then;
+  bool32 condition;
+  if (interpreter_condition_is_ready (expr, task->frame, &condition))
     {
-      local_variables = malloc (sizeof(DICT(ObjVars)));
-      DictObjVars_init (local_variables, hash_string, string_compare, 10);
-      new_variable_scope_stack = 
-        interpreter_create_new_variable_scope_stack (local_variables,
-                                                     variable_scope_stack);
+      interpreter_loop_iterate (task, condition);
+      return;
     }
-  else
+  then = *task;
+  then.type = TASK_LOOP_TEST;
+  interpreter_evaluate_then (&then, &expr, 1);
+}
+
+void
+interpreter_loop_iterate (const struct InterpreterTask *task,
+                          bool32 condition)
+{
+  struct AST *loop = ast_get_node (task->node);
+  ASTHandle body_handle = interpreter_loop_body (loop);
+  struct AST *body = ast_get_node (body_handle);
+  struct InterpreterTask next;
+  /* when it's done the body's frame is left by the task under it */
+  if (!condition)
+    return;
+
+  /* the test runs again after the body and the step */
+  next = *task;
+  next.type = TASK_LOOP;
+  STACK_PUSH (&interpreter_tasks, next);
+  if (loop->type == AST_FOR && loop->d.for_data.step)
+    interpreter_push_task (TASK_LOOP_STEP, task->node, task->frame);
+  if (!body)
+    return;
+  if (body->d.scope_data.has_frame)
+    interpreter_clear_frame (task->index,
+                             ARRAY_COUNT (body->d.scope_data.locals));
+  interpreter_push_task (TASK_RUN_SCOPE, body_handle, task->index);
+}
+
+AmpValue
+interpreter_make_list (ASTHandle handle)
+{
+  struct AST *s = ast_get_node (handle);
+  size_t count = ARRAY_COUNT (s->d.list_data.items);
+  AmpValue *items = &interpreter_values.mem[interpreter_values.size - count];
+  AmpValue *objects = NULL;
+  size_t i;
+  for (i = 0; i < count; i++)
     {
-      new_variable_scope_stack = variable_scope_stack;
+      /* the list takes over the reference of each of its items */
+      ARRAY_PUSH (objects, items[i]);
     }
-
-  statement_count = ARRAY_COUNT (scope->d.scope_data.statements);
-  for (i = 0; i < statement_count; i++)
+  for (i = 0; i < count; i++)
     {
-      AmpObject *obj = NULL;
-      obj = interpreter_evaluate_statement (scope->d.scope_data.statements[i],
-                                            new_variable_scope_stack,
-                                            should_return);
-      if (obj)
-        {
-          if (!(*should_return))
-            AmpObjectDecrementRefcount (obj);
-        }
-      if (*should_return) 
-        {
-          /* if there is a ret value, it's ref count will be high enough
-           * so that it's not freed by the free local variables func */
-          interpreter_free_local_variables (new_variable_scope_stack[0]);
-          ARRAY_FREE (new_variable_scope_stack);
-          return obj;
-        }
+      STACK_POP (&interpreter_values);
     }
-
-#ifdef INTERPRETER_DEBUG
-  debug__interpreter_print_all_vars (new_variable_scope_stack[0]);
-#endif
-  interpreter_free_local_variables (new_variable_scope_stack[0]);
-  ARRAY_FREE (new_variable_scope_stack);
-
-  return NULL;
+  return AmpListCreate (objects);
 }
 
-AmpObject *
-interpreter_evaluate_if (ASTHandle statement,
-                         DICT (ObjVars) **variable_scope_stack,
-                         bool32 *return_from_scope)
+AmpValue *
+interpreter_find_variable (const struct VarLocation *loc, size_t frame)
 {
-  struct AST *if_node = ast_get_node (statement);
-  if (if_node->type == AST_IF)
+  unsigned int depth;
+  if (loc->global)
+    return &interpreter_slots[loc->slot];
+  for (depth = loc->depth; depth > 0; depth--)
     {
-      /* run different scopes depending on the if's true or false */
-      struct AST *expr_node = ast_get_node (statement);
-      AmpObject *is_expr_true;
-      AmpObject *scope_ret = NULL;
+      frame = interpreter_frames[frame].parent;
+    }
+  return &interpreter_slots[interpreter_frames[frame].base + loc->slot];
+}
 
-      /* expr_node should evaluate to a bool32 */
-      is_expr_true = 
-        interpreter_evaluate_statement_to_bool32 (expr_node->d.if_data.expr,
-                                                  variable_scope_stack);
+size_t
+interpreter_push_frame (size_t parent, size_t slot_count)
+{
+  struct InterpreterFrame frame;
+  size_t needed = interpreter_slot_count + slot_count;
+  size_t i;
+  if (needed > interpreter_slot_capacity)
+    {
+      size_t new_capacity = interpreter_slot_capacity
+                              ? interpreter_slot_capacity : 64;
+      while (new_capacity < needed)
+        new_capacity *= 2;
+      if (interpreter_slots)
+        interpreter_slots = realloc (interpreter_slots,
+                                     new_capacity * sizeof (AmpValue));
+      else
+        interpreter_slots = malloc (new_capacity * sizeof (AmpValue));
+      interpreter_slot_capacity = new_capacity;
+    }
+  for (i = interpreter_slot_count; i < needed; i++)
+    {
+      interpreter_slots[i] = AMP_VALUE_EMPTY;
+    }
+  frame.parent = parent;
+  frame.base = interpreter_slot_count;
+  interpreter_slot_count = needed;
+  ARRAY_PUSH (interpreter_frames, frame);
+  return ARRAY_COUNT (interpreter_frames) - 1;
+}
 
-      if (AMP_BOOL (is_expr_true)->val)
-      scope_ret = interpreter_evaluate_scope (expr_node->d.if_data.scope_if_true,
-                                    variable_scope_stack,
-                                    false,
-                                    return_from_scope);
-      else if (AMP_BOOL(is_expr_true)->val == false &&
-               expr_node->d.if_data.scope_if_false)
-      scope_ret = interpreter_evaluate_scope (expr_node->d.if_data.scope_if_false,
-                                    variable_scope_stack,
-                                    false,
-                                    return_from_scope);
+void
+interpreter_pop_frame (size_t frame)
+{
+  size_t base = interpreter_frames[frame].base;
+  size_t i;
+  for (i = base; i < interpreter_slot_count; i++)
+    {
+      AmpValueDecrementRefcount (interpreter_slots[i]);
+    }
+  interpreter_slot_count = base;
+  while (ARRAY_COUNT (interpreter_frames) > frame)
+    {
+      ARRAY_POP (interpreter_frames);
+    }
+}
 
+void
+interpreter_clear_frame (size_t frame, size_t slot_count)
+{
+  AmpValue *slots = &interpreter_slots[interpreter_frames[frame].base];
+  size_t i;
+  for (i = 0; i < slot_count; i++)
+    {
+      AmpValueDecrementRefcount (slots[i]);
+      slots[i] = AMP_VALUE_EMPTY;
+    }
+}
 
-      AmpObjectDecrementRefcount (is_expr_true);
-      if (scope_ret)
-        return scope_ret;
+void
+interpreter_check_stack_limit (void)
+{
+  size_t used = interpreter_tasks.size * sizeof (struct InterpreterTask)
+                + interpreter_values.size * sizeof (AmpValue)
+                + interpreter_slot_count * sizeof (AmpValue)
+                + ARRAY_COUNT (interpreter_frames)
+                    * sizeof (struct InterpreterFrame);
+  if (used > interpreter_stack_limit)
+    {
+      printf (ample_error_codes[ERROR_STACK_OVERFLOW],
+              (unsigned int) (interpreter_stack_limit >> 20));
+      exit (1);
     }
-  return NULL;
 }
 
-AmpObject *
-interpreter_get_amp_object (const char *var,
-                            DICT (ObjVars) **variable_scope_stack)
+void
+interpreter_insert_function_into_dict (ASTHandle func_handle)
 {
-  AmpObject *obj = NULL;
-  bool32 success = false;
-  size_t i;
-  for (i = 0; i < ARRAY_COUNT (variable_scope_stack); i++)
+  Symbol func_name = ast_get_node (func_handle)->d.func_data.name;
+  DictFunc_insert (&func_dict, func_name, func_handle);
+  interpreter_function_generation++;
+}
+
+AmpValue
+interpreter_compare (ASTHandle handle, AmpValue left_obj, AmpValue right_obj)
+{
+  struct AST *binary_comparison_ast = ast_get_node (handle);
+  AmpValue retval = AMP_VALUE_EMPTY;
+
+  if (AMP_VALUE_IS_NUMBER (left_obj) && AMP_VALUE_IS_NUMBER (right_obj))
+    return interpreter_compare_numbers (binary_comparison_ast->d.bcmp_data.type,
+                                        AMP_VALUE_TO_NUMBER (left_obj),
+                                        AMP_VALUE_TO_NUMBER (right_obj));
+  if (AMP_VALUE_TYPE (left_obj) == AMP_VALUE_TYPE (right_obj))
     {
-      success = DictObjVars_get (variable_scope_stack[i], var, &obj);
-      if (success)
-        break;
+      if (binary_comparison_ast->d.bcmp_data.type == BOP_EQUAL)
+        retval = AmpValueInfo (left_obj)->ops.equal (left_obj, right_obj);
+      else if (binary_comparison_ast->d.bcmp_data.type == BOP_NOT_EQUAL)
+        retval = AmpValueInfo (left_obj)->ops.not_equal (left_obj, right_obj);
+      else if (binary_comparison_ast->d.bcmp_data.type == BOP_LESS_THAN)
+        retval = AmpValueInfo (left_obj)->ops.less_than (left_obj, right_obj);
+      else if (binary_comparison_ast->d.bcmp_data.type == BOP_GREATER_THAN)
+        retval = AmpValueInfo (left_obj)->ops.greater_than (left_obj, right_obj);
     }
-  if (!success)
+  else
     {
-      printf ("Variable \"%s\" does not exist\n", var);
+      printf (ample_error_codes[ERROR_OPERATION_ON_DIFFERENT_TYPES],
+              AMP_OBJECT_TYPE_STR[AMP_VALUE_TYPE (left_obj)],
+              AMP_OBJECT_TYPE_STR[AMP_VALUE_TYPE (right_obj)]);
       exit (1);
     }
-  return obj;
+  AmpValueDecrementRefcount (left_obj);
+  AmpValueDecrementRefcount (right_obj);
+  return retval;
 }
 
-/* returns an owning pointer to an Amp Object
-   i.e the object returned will have it's reference counter incremented */
-AmpObject *
-InterpreterGetOrGenerateAmpObject (ASTHandle handle,
-                                   DICT (ObjVars) **__restrict__ variable_scope_stack)
+AmpValue
+interpreter_compare_numbers (BinaryOpBoolType type,
+                             double left,
+                             double right)
 {
-  struct AST *node = ast_get_node (handle);
-  AmpObject *obj = NULL;
-  switch (node->type)
+  switch (type)
     {
-    case AST_IDENTIFIER:
-      obj = interpreter_get_amp_object (node->d.id_data.id,
-                                        variable_scope_stack);
-      AmpObjectIncrementRefcount (obj);
-      break;
-    case AST_INTEGER:
-      obj = AmpNumberCreate (node->d.int_data.value);
-      break;
-    case AST_STRING:
-      obj = AmpStringCreate (node->d.str_data.str);
-      break;
-    case AST_BOOL:
-      obj = AmpBoolCreate (node->d.bool_data.value);
-      break;
-    case AST_BINARY_OP:
-      obj = interpreter_evaluate_binary_op (handle, variable_scope_stack);
-      break;
-    case AST_FUNC_CALL:
-      obj = interpreter_evaluate_function_call (handle, variable_scope_stack, NULL);
-      break;
-    case AST_BINARY_COMPARATOR:
-      obj = interpreter_evaluate_binary_comparison (handle, variable_scope_stack);
-      break;
-    case AST_LIST:
-      obj = interpreter_evaluate_list (handle,
-                                       variable_scope_stack,
-                                       NULL);
-      break;
-    default:
-      assert (false);
-      break;
+    case BOP_EQUAL: return AMP_VALUE_FROM_BOOL (AMP_NUMBER_EQUAL (left, right));
+    case BOP_NOT_EQUAL:
+      return AMP_VALUE_FROM_BOOL (!AMP_NUMBER_EQUAL (left, right));
+    case BOP_LESS_THAN: return AMP_VALUE_FROM_BOOL (left < right);
+    /* like amp_integer_greater_than, equal numbers count as greater */
+    case BOP_GREATER_THAN: return AMP_VALUE_FROM_BOOL (!(left < right));
+    default: return AMP_VALUE_EMPTY;
+    }
+}
+
+AmpValue
+interpreter_get_amp_object (const struct IdentifierAST *id, size_t frame)
+{
+  AmpValue obj = *interpreter_find_variable (&id->loc, frame);
+  if (AMP_VALUE_IS_EMPTY (obj))
+    {
+      printf ("Variable \"%s\" does not exist\n", SymbolName (id->id));
+      exit (1);
     }
   return obj;
 }
 
-AmpObject *
-interpreter_evaluate_binary_op (ASTHandle handle,
-                                DICT (ObjVars) **variable_scope_stack)
+AmpValue
+interpreter_binary_op (ASTHandle handle, AmpValue left, AmpValue right)
 {
   struct AST *node = ast_get_node (handle);
-
-  if (node->type == AST_BINARY_OP)
+  if (AMP_VALUE_IS_NUMBER (left) && AMP_VALUE_IS_NUMBER (right))
+    return interpreter_number_op (node->d.bop_data.op,
+                                  AMP_VALUE_TO_NUMBER (left),
+                                  AMP_VALUE_TO_NUMBER (right));
+  if (AMP_VALUE_TYPE (left) == AMP_VALUE_TYPE (right))
     {
-      ASTHandle right_handle = node->d.bop_data.right;
-      ASTHandle left_handle = node->d.bop_data.left;
-      struct AST *right_node = ast_get_node (right_handle);
-      struct AST *left_node = ast_get_node (left_handle);
-      AmpObject *left = NULL, *right = NULL;
-
-      if (right_node->type != AST_BINARY_OP)
-        {
-          right = InterpreterGetOrGenerateAmpObject (right_handle,
-                                                          variable_scope_stack);
-        }
-      else if (right_node->type == AST_BINARY_OP)
-        {
-          right = interpreter_evaluate_binary_op (right_handle,
-                                                  variable_scope_stack);
-        }
-      else
-        {
-          exit (1);
-        }
+      AmpValue obj = AMP_VALUE_EMPTY;
 
-      if (left_node->type != AST_BINARY_OP)
+      /* a string nothing else holds would be freed below,
+       * so the result is built in it instead */
+      if (node->d.bop_data.op == '+' && AMP_STRING_IS_UNSHARED (left)
+          && left != right)
         {
-          left = InterpreterGetOrGenerateAmpObject (left_handle,
-                                                         variable_scope_stack);
-        }
-      else if (left_node->type == AST_BINARY_OP)
-        {
-          left = interpreter_evaluate_binary_op (left_handle,
-                                                 variable_scope_stack);
-        }
-      else
-        {
-          exit (1);
-        }
-
-      if (left->info->type == right->info->type)
-        {
-          AmpObject *obj = NULL;
-
-          switch (node->d.bop_data.op)
-            {
-              case '+': obj = right->info->ops.add (right, left);
-                        break;
-              case '-': obj = right->info->ops.sub (right, left);
-                        break;
-              case '*': obj = right->info->ops.mult (right, left);
-                        break;
-              case '/': obj = right->info->ops.div (right, left);
-                        break;
-              default: printf ("Invalid binary operation\n");
-                       exit (1);
-            }
-          AmpObjectDecrementRefcount (left);
-          AmpObjectDecrementRefcount (right);
+          obj = AmpStringAppend (left, right);
+          AmpValueDecrementRefcount (right);
           return obj;
         }
-      else
+      switch (node->d.bop_data.op)
         {
-          printf ("Attempting binary operation on values of different types\n");
-          exit (1);
+          case '+': obj = AmpValueInfo (left)->ops.add (left, right);
+                    break;
+          case '-': obj = AmpValueInfo (left)->ops.sub (left, right);
+                    break;
+          case '*': obj = AmpValueInfo (left)->ops.mult (left, right);
+                    break;
+          case '/': obj = AmpValueInfo (left)->ops.div (left, right);
+                    break;
+          default: printf ("Invalid binary operation\n");
+                   exit (1);
         }
+      AmpValueDecrementRefcount (left);
+      AmpValueDecrementRefcount (right);
+      return obj;
+    }
+  else
+    {
+      printf ("Attempting binary operation on values of different types\n");
+      exit (1);
     }
-  return 0;
 }
 
-void
-interpreter_duplicate_variable (const char *var,
-                                const char *assign,
-                                DICT (ObjVars) **variable_scope_stack,
-                                size_t scope_stack_index)
+AmpValue
+interpreter_number_op (TValue op, double left, double right)
 {
-  AmpObject *obj = interpreter_get_amp_object (var, variable_scope_stack);
-  DICT (ObjVars) *local_vars = variable_scope_stack[scope_stack_index];
-  /* new variable will be referencing the same memory */
-  AmpObjectIncrementRefcount (obj);
-  interpreter_add_obj_mapping (assign, obj, local_vars);
+  switch (op)
+    {
+    case '+': return AmpNumberCreate (left + right);
+    case '-': return AmpNumberCreate (left - right);
+    case '*': return AmpNumberCreate (left * right);
+    case '/': return AmpNumberCreate (left / right);
+    default: printf ("Invalid binary operation\n");
+             exit (1);
+    }
 }
 
 void
-interpreter_evaluate_assignment (ASTHandle statement,
-                                 DICT (ObjVars) **variable_scope_stack)
+interpreter_assign (ASTHandle statement, AmpValue obj, size_t frame)
 {
   struct AST *s = ast_get_node (statement);
-  struct AST *expr = ast_get_node (s->d.asgn_data.expr);
-  size_t i;
-  const char *var = s->d.asgn_data.var;
-  size_t scope_stack_index = 0;
-
-  /* make sure that the variable doesn't already exist in a parent scope */
-  bool32 exists_in_parent_scope = false;
-  for (i = 1; i < ARRAY_COUNT (variable_scope_stack); i++)
-    {
-      AmpObject *parent_obj = NULL;
-      exists_in_parent_scope = DictObjVars_get (variable_scope_stack[i],
-                                                var,
-                                                &parent_obj);
-      if (exists_in_parent_scope)
-        {
-          scope_stack_index = i;
-          break;
-        }
+  AmpValue *variable = interpreter_find_variable (&s->d.asgn_data.loc,
+                                                    frame);
+  if (AMP_VALUE_IS_EMPTY (obj))
+    {
+      printf ("Variable \"%s\" is assigned a value that does not exist\n",
+              SymbolName (s->d.asgn_data.var));
+      exit (1);
     }
-  AmpObject *obj = 
-    interpreter_evaluate_statement (s->d.asgn_data.expr, variable_scope_stack, NULL);
-  if (expr->type == AST_IDENTIFIER)
-    interpreter_duplicate_variable (expr->d.id_data.id,
-                                    var,
-                                    variable_scope_stack,
-                                    scope_stack_index);
-  else 
-    interpreter_add_obj_mapping (var,
-                                 obj,
-                                 variable_scope_stack[scope_stack_index]);
-                         
+  AmpValueDecrementRefcount (*variable);
+  *variable = obj;
 }
 
+#ifdef INTERPRETER_DEBUG
+void
+debug__interpreter_print_all_vars (Symbol *names, AmpValue *vars)
+{
+  size_t i;
+  for (i = 0; i < ARRAY_COUNT (names); i++)
+    {
+      printf ("%s: ", SymbolName (names[i]));
+      if (!AMP_VALUE_IS_EMPTY (vars[i]))
+        ample_print_object (vars[i]);
+      else
+        printf ("(unassigned)");
+      printf ("\n");
+    }
+}
+#endif
@@ -18,103 +18,158 @@
 #define INTERPRETER_H_
 #include "objects/ampobject.h"
 #include "ast.h"
+/* The variables of one scope. Frames live in one array and their
+ * variables in another, so entering a scope only moves the top of
+ * those arrays. A block's parent is the scope around it, a function's
+ * frame has no parent since it can only see the globals */
+struct InterpreterFrame {
+  size_t parent; /* index of the parent frame or INTERPRETER_NO_FRAME */
+  size_t base;   /* index of the frame's first variable */
+};
+#define INTERPRETER_NO_FRAME ((size_t) -1)
+
+/* The evaluator never recurses on the C stack. What is left to do for
+ * a node is a task on a heap stack and the values of evaluated
+ * expressions wait on a second one. A task that needs the values of
+ * other nodes pushes the tasks that evaluate them on top of itself, so
+ * when it runs again they are the newest values */
+typedef enum InterpreterTaskType {
+  TASK_EVALUATE,        /* pushes the value of an expression */
+  TASK_RUN_SCOPE,       /* runs the statement at index of a scope */
+  TASK_LEAVE_SCOPE,     /* pops the frame of a block */
+  TASK_ENTER_FUNCTION,  /* the arguments are evaluated, target is called */
+  TASK_LEAVE_FUNCTION,  /* pops a function's frame, the call's value
+                           is empty unless it returned one */
+  TASK_RETURN,          /* unwinds to the newest TASK_LEAVE_FUNCTION */
+  TASK_CALL_BUILTIN,
+  TASK_BINARY_OP,
+  TASK_COMPARE,
+  TASK_MAKE_LIST,
+  TASK_ASSIGN,
+  TASK_BRANCH,          /* picks the arm of an if by its condition */
+  TASK_LOOP,            /* tests the condition of a loop */
+  TASK_LOOP_TEST,       /* the condition is evaluated, runs the body
+                           or ends the loop */
+  TASK_LOOP_STEP,       /* runs the step of a for loop */
+  TASK_DISCARD,         /* drops the value of an expression statement */
+} InterpreterTaskType;
+
+struct InterpreterTask {
+  InterpreterTaskType type;
+  ASTHandle node;
+  ASTHandle target;   /* the function a call enters */
+  /* the next statement of a scope, the frame of a loop's body.
+   * A function being left drops its value when it's set */
+  unsigned int index;
+  size_t frame;       /* the frame the node runs in */
+};
+
 /* ******************
    External functions
    ****************** */
-void InterpreterStart(ASTHandle head);
-/* Returns an amp object that will be created if none exist already */
-AmpObject *
-InterpreterGetOrGenerateAmpObject(ASTHandle handle,
-                                  DICT (ObjVars) **variable_scope_stack);
+/* Runs the program. The frames, tasks and values of the running calls
+ * may take up to stack_limit bytes, a program that recurses deeper is
+ * stopped with a stack overflow error */
+void InterpreterStart(ASTHandle head, size_t stack_limit);
 
 /* ******************
    Internal Functions
    ****************** */
-/* top level evaluate function that will call more specific
- * evaluations depending on a node's type */
-AmpObject *
-interpreter_evaluate_statement(ASTHandle statement,
-                               DICT (ObjVars) **variable_scope_stack,
-                               bool32 *return_from_scope);
-AmpObject *
-interpreter_evaluate_list (ASTHandle statement,
-                           DICT (ObjVars) **variable_scope_stack,
-                           bool32 *return_from_scope);
-/* evaluates an ast node of type AST_BINARY_OP */
-AmpObject *
-interpreter_evaluate_binary_op(ASTHandle handle,
-                               DICT (ObjVars) **variable_scope_stack);
-/* evaluates an ast node of type  AST_ASSIGNMENT */
-void
-interpreter_evaluate_assignment(ASTHandle statement,
-                                DICT (ObjVars) **variable_scope_stack);
-/* evaluates an ast node of type AST_IF */
-AmpObject *
-interpreter_evaluate_if(ASTHandle statement,
-                        DICT (ObjVars) **variable_scope_stack,
-                        bool32 *return_from_scope);
-/* removes a dict entry and decrements the refcount of the amp object
- * that it's associated with */
-void
-interpreter_erase_variable_if_exists(const char *var,
-                                     DICT (ObjVars) *local_variables);
-/* creates a new dict entry pointing to an existing AmpObject and
- * incrementing that objects refcount */
+/* pops and runs tasks until there are none left */
+void interpreter_run(void);
+/* runs a task whose values are on top of the value stack */
+void interpreter_run_task(const struct InterpreterTask *task);
 void
-interpreter_duplicate_variable(const char *var,
-                               const char *assign,
-                               DICT (ObjVars) **variable_scope_stack,
-                               size_t scope_stack_index);
-AmpObject *
-interpreter_find_variable (const char *var,
-                           DICT (ObjVars) **variable_scope_stack);
+interpreter_push_task(InterpreterTaskType type, ASTHandle node, size_t frame);
+void interpreter_init_task(struct InterpreterTask *task,
+                           InterpreterTaskType type,
+                           ASTHandle node,
+                           size_t frame);
+/* runs a statement of a scope, or pushes the tasks that will */
+void interpreter_run_statement(ASTHandle statement, size_t frame);
+/* pushes the value of a variable or a literal and returns true,
+ * any other node is left alone */
+bool32 interpreter_evaluate_leaf(ASTHandle handle, size_t frame);
+/* pushes the value of an expression, or the tasks that will */
+void interpreter_evaluate(ASTHandle handle, size_t frame);
+/* pushes the values of the nodes in order and then runs the task then.
+ * Leading leaves are pushed right away, everything from the first other
+ * node on runs as tasks. If all of them are leaves then runs right away */
+void interpreter_evaluate_then(const struct InterpreterTask *then,
+                               ASTHandle *nodes,
+                               size_t count);
+/* starts a call, statement is set if its value isn't used, that's the
+ * only place a return is allowed */
+void interpreter_call(ASTHandle func_call, size_t frame, bool32 statement);
+void interpreter_enter_function(const struct InterpreterTask *task);
+/* if the call is a tail call it ends the running function, except
+ * for its leave task which the called function takes over */
+bool32 interpreter_leave_for_tail_call(ASTHandle func_call);
+/* the return value is on top of the value stack */
+void interpreter_return(void);
+/* starts running the statements of a scope. When in_frame is set the
+ * statements run in frame instead of a new frame of their own */
+void interpreter_enter_scope(ASTHandle scope_handle,
+                             size_t frame,
+                             bool32 in_frame);
+void interpreter_leave_scope(const struct InterpreterTask *task);
+/* runs the initializer of a loop and pushes its first test */
+void interpreter_start_loop(ASTHandle loop_handle, size_t frame);
+ASTHandle interpreter_loop_body(struct AST *loop);
+void interpreter_loop_test(const struct InterpreterTask *task);
+/* pushes the body, step and next test of the loop if condition is set */
+void interpreter_loop_iterate(const struct InterpreterTask *task,
+                              bool32 condition);
+/* enters the arm of an if that is picked by condition */
+void interpreter_branch(ASTHandle if_handle, bool32 condition, size_t frame);
+/* reads the condition of an if or loop right away when it's a bool or
+ * a variable. Returns false if it's an expression that has to be
+ * evaluated first */
+bool32 interpreter_condition_is_ready(ASTHandle expr_handle,
+                                      size_t frame,
+                                      bool32 *condition);
+/* pops an evaluated condition, which has to be a bool */
+bool32 interpreter_pop_condition(void);
+AmpValue interpreter_pop_value(void);
+void interpreter_push_value(AmpValue value);
+AmpValue interpreter_binary_op(ASTHandle handle, AmpValue left, AmpValue right);
+AmpValue interpreter_compare(ASTHandle handle, AmpValue left, AmpValue right);
+/* the arithmetic and comparisons of two numbers, which need neither
+ * the operation table nor refcounting */
+AmpValue interpreter_number_op(TValue op, double left, double right);
+AmpValue interpreter_compare_numbers(BinaryOpBoolType type,
+                                     double left,
+                                     double right);
+AmpValue interpreter_make_list(ASTHandle handle);
+void interpreter_assign(ASTHandle statement, AmpValue obj, size_t frame);
+/* returns the storage of a resolved variable */
+AmpValue *
+interpreter_find_variable (const struct VarLocation *loc, size_t frame);
 /* Returns an amp object that already exists as a variable */
-AmpObject *
-interpreter_get_amp_object(const char *var,
-                           DICT (ObjVars) **variable_scope_stack);
-/* Add an object to the variable map for easy storage/access */
-void
-interpreter_add_obj_mapping(const char *var_name,
-                            AmpObject *obj,
-                            DICT (ObjVars) *local_variables);
-/* Increments through a scope ast node's list of statements 
- * and evaulates them */
-AmpObject *
-interpreter_evaluate_scope (ASTHandle scope_handle,
-                            DICT (ObjVars) **variable_scope_stack,
-                            bool32 local_scope_already_created,
-                            bool32 *should_return);
-/* evaluates a statement if the resulting evaluation is a bool32 */
-AmpObject *
-interpreter_evaluate_statement_to_bool (ASTHandle statement_handle,
-                                        DICT (ObjVars) **variable_scope_stack);
-/* evaluates each side of an binary_comparison statement 
- * and returns true if the statement is true */
-AmpObject *
-interpreter_evaluate_binary_comparison (ASTHandle binary_comparison_handle, 
-                                        DICT (ObjVars) **variable_scope_stack);
+AmpValue
+interpreter_get_amp_object(const struct IdentifierAST *id, size_t frame);
 /* insert the func_handle into a dict using the func name as the key */
 void 
 interpreter_insert_function_into_dict (ASTHandle func_handle);
 
-AmpObject *
-interpreter_evaluate_function_call (ASTHandle func_call, 
-                                    DICT (ObjVars) **variable_scope_stack,
-                                    bool32 *return_from_scope);
-
-/* will decrement all references of the variables in the dict,
- * then will call Dict Free and then free the pointer "local_variables" */
+/* makes room for slot_count unassigned variables on top of the slot
+ * array and returns the new frame. No memory is allocated unless the
+ * arrays have to grow */
+size_t
+interpreter_push_frame (size_t parent, size_t slot_count);
+/* releases the variables of the frame and of every frame newer than it */
 void
-interpreter_free_local_variables (DICT (ObjVars) *local_variables);
-
-/* puts local variables at index 0 of a new array of variable dictionaries */
-DICT (ObjVars) **
-interpreter_create_new_variable_scope_stack (DICT (ObjVars) *local_variables,
-                                             DICT (ObjVars) **var_scope_stack);
+interpreter_pop_frame (size_t frame);
+/* unassigns the first slot_count variables of the frame */
+void
+interpreter_clear_frame (size_t frame, size_t slot_count);
+/* stops the program once the running calls take up more memory
+ * than the limit */
+void
+interpreter_check_stack_limit (void);
 
 /* ***************
  * Debug Functions
  * *************** */
-void debug__interpreter_print_all_vars(DICT (ObjVars) *vars);
-AmpObject *debug__interpreter_get_variable_object (const char *var);
+void debug__interpreter_print_all_vars(Symbol *names, AmpValue *vars);
 #endif
@@ -17,7 +17,6 @@
 #include "ast.h"
 #include "ncl.h"
 #include "bool.h"
-#include "dict_vars.h"
 #include "interpreter.h"
 #include "ample_errors.h"
 #include "objects/ampobject.h"
@@ -33,71 +32,32 @@
 #include <stdio.h>
 #include <errno.h>
 #include <limits.h>
-bool32 ExecuteAmpleFunction (ASTHandle  *restrict args,
-                             size_t arg_count,
-                             const char *restrict func_name,
-                             DICT (ObjVars) **restrict variable_scope_stack,
-                             AmpObject **ret_object,
-                             bool32 *return_from_scope)
+#define X(id, name, arg_count, function) { name, arg_count, function },
+const struct AmpleBuiltin AMPLE_BUILTIN_TABLE[] = {
+  AMPLE_BUILTINS
+};
+#undef X
+
+AmpleBuiltinId
+AmpleBuiltinFind (const char *name)
 {
-  *ret_object = NULL;
-  if (0 == strncmp ("print", func_name, 5))
-    {
-      ample_print (args, arg_count, func_name, variable_scope_stack);
-      if (return_from_scope)
-        *return_from_scope = false;
-      return true;
-    }
-  else if (0 == strncmp ("str", func_name, 3))
-    {
-      *ret_object = ample_cast_object_to_string (args,
-                                                 arg_count,
-                                                 func_name,
-                                                 variable_scope_stack);
-      if (return_from_scope)
-        *return_from_scope = false;
-      return true;
-    }
-  else if (0 == strncmp ("int", func_name, 3))
+  unsigned int i;
+  for (i = 0; i < AMPLE_BUILTIN_NONE; i++)
     {
-      *ret_object = ample_cast_object_to_integer (args,
-                                                  arg_count,
-                                                  func_name,
-                                                  variable_scope_stack);
-      if (return_from_scope)
-        *return_from_scope = false;
-      return true;
+      if (0 == strcmp (AMPLE_BUILTIN_TABLE[i].name, name))
+        return (AmpleBuiltinId) i;
     }
-  else if (0 == strncmp ("bool", func_name, 4))
-    {
-      *ret_object = ample_cast_object_to_bool (args,
-                                               arg_count,
-                                               func_name,
-                                               variable_scope_stack);
-      if (return_from_scope)
-        *return_from_scope = false;
-      return true;
-    }
-  else if (0 == strncmp ("return", func_name, 5))
-    {
-      if (return_from_scope)
-        *return_from_scope = true;
-      else
-        return false;
+  return AMPLE_BUILTIN_NONE;
+}
 
-      if (arg_count == 0)
-        {
-          return true;
-        }
-      else
-        {
-          ample_function_check_arg_numbers (arg_count, 1, func_name);
-          *ret_object = InterpreterGetOrGenerateAmpObject (args[0],
-                                                           variable_scope_stack);
-          return true;
-        }
-    }
-  return false;
+AmpValue
+AmpleBuiltinCall (AmpleBuiltinId id, AmpValue *args, size_t arg_count)
+{
+  const struct AmpleBuiltin *builtin = &AMPLE_BUILTIN_TABLE[id];
+  ample_function_check_arg_numbers (arg_count,
+                                    builtin->arg_count,
+                                    builtin->name);
+  return builtin->function (args);
 }
 
 void
@@ -115,29 +75,29 @@ ample_function_check_arg_numbers (size_t count,
     }
 }
 
-void ample_print_object (AmpObject *obj)
+void ample_print_object (AmpValue obj)
 {
-  switch (obj->info->type)
+  switch (AMP_VALUE_TYPE (obj))
     {
     case AMP_OBJECT_NUMBER:
-      printf ("%f", AMP_NUMBER (obj)->val);
+      printf ("%f", AMP_VALUE_TO_NUMBER (obj));
       break;
     case AMP_OBJECT_STRING:
       printf ("%s", AMP_STRING (obj)->string);
       break;
     case AMP_OBJECT_BOOL:
-      printf ("%s", AMP_BOOL (obj)->val ? "true" : "false");
+      printf ("%s", AMP_VALUE_TO_BOOL (obj) ? "true" : "false");
       break;
     case AMP_OBJECT_LIST:
       {
         size_t i;
-        printf("[ ");
-        for (i = 0; i < ARRAY_COUNT (AMP_LIST (obj)->array) - 1; i++)
+        size_t count = ARRAY_COUNT (AMP_LIST (obj)->array);
+        printf ("[");
+        for (i = 0; i < count; i++)
           {
+            printf (i > 0 ? ", " : " ");
             ample_print_object (AMP_LIST (obj)->array[i]);
-            printf (", ");
           }
-        ample_print_object (AMP_LIST (obj)->array[i]);
         printf (" ]");
       }
       break;
@@ -148,72 +108,43 @@ void ample_print_object (AmpObject *obj)
     }
 }
 
-void
-ample_print (ASTHandle  *restrict args,
-             size_t arg_count,
-             const char *restrict func_name,
-             DICT (ObjVars) **restrict variable_scope_stack)
-{
-  AmpObject *obj;
-  ample_function_check_arg_numbers (arg_count, 1, func_name);
-  /* get the argument */
-  obj = InterpreterGetOrGenerateAmpObject (args[0],
-                                           variable_scope_stack);
-  ample_print_object (obj);
-  printf ("\n");
-  AmpObjectDecrementRefcount (obj); 
-}
 
-AmpObject *
-ample_cast_object_to_string (ASTHandle *restrict args,
-                             size_t arg_count,
-                             const char *restrict func_name,
-                             DICT (ObjVars) **restrict variable_scope_stack)
+AmpValue
+ample_object_to_string (AmpValue obj)
 {
-  AmpObject *obj, *ret_object = NULL;
-  ample_function_check_arg_numbers (arg_count, 1, func_name);
-  /* get the argument */
-  obj = InterpreterGetOrGenerateAmpObject (args[0],
-                                           variable_scope_stack);
-  switch (obj->info->type)
+  AmpValue ret_object = AMP_VALUE_EMPTY;
+  switch (AMP_VALUE_TYPE (obj))
     {
     case AMP_OBJECT_NUMBER: {
-      char* str = NCL_DoubleToString (AMP_NUMBER (obj)->val);
+      char* str = NCL_DoubleToString (AMP_VALUE_TO_NUMBER (obj));
       ret_object = AmpStringCreate (str);
       free (str);
     } break;
     case AMP_OBJECT_STRING:
-      AmpObjectIncrementRefcount (obj);
+      AmpValueIncrementRefcount (obj);
       ret_object = obj;
       break;
     case AMP_OBJECT_BOOL:
-      ret_object = AmpStringCreate (AMP_BOOL (obj)->val ? "true" : "false");
+      ret_object = AmpStringCreate (AMP_VALUE_TO_BOOL (obj) ? "true" : "false");
       break;
     default:
       printf (ample_error_codes[ERROR_INVALID_CAST],
-              AMP_OBJECT_TYPE_STR[obj->info->type],
+              AMP_OBJECT_TYPE_STR[AMP_VALUE_TYPE (obj)],
               AMP_OBJECT_TYPE_STR[AMP_OBJECT_STRING]);
       exit (1);
     }
-  AmpObjectDecrementRefcount (obj);
   return ret_object;
 }
 
-AmpObject *
-ample_cast_object_to_integer (ASTHandle *restrict args,
-                              size_t arg_count,
-                              const char *restrict func_name,
-                              DICT (ObjVars) **restrict variable_scope_stack)
+
+AmpValue
+ample_object_to_integer (AmpValue obj)
 {
-  AmpObject *obj, *ret_object = NULL;
-  ample_function_check_arg_numbers (arg_count, 1, func_name);
-  /* get the argument */
-  obj = InterpreterGetOrGenerateAmpObject (args[0],
-                                           variable_scope_stack);
-  switch (obj->info->type)
+  AmpValue ret_object = AMP_VALUE_EMPTY;
+  switch (AMP_VALUE_TYPE (obj))
     {
     case AMP_OBJECT_NUMBER: {
-      int num = (int) AMP_NUMBER (obj)->val; 
+      int num = (int) AMP_VALUE_TO_NUMBER (obj); 
       ret_object = AmpNumberCreate (num);
     } break;
     case AMP_OBJECT_STRING: {
@@ -229,14 +160,14 @@ ample_cast_object_to_integer (ASTHandle *restrict args,
           || (errno != 0 && val == 0))
         {
           printf (ample_error_codes[ERROR_INVALID_CAST],
-                  AMP_OBJECT_TYPE_STR[obj->info->type],
+                  AMP_OBJECT_TYPE_STR[AMP_VALUE_TYPE (obj)],
                   AMP_OBJECT_TYPE_STR[AMP_OBJECT_STRING]);
           exit(EXIT_FAILURE);
         }
       if (endptr == str)
         {
           printf (ample_error_codes[ERROR_INVALID_CAST],
-                  AMP_OBJECT_TYPE_STR[obj->info->type],
+                  AMP_OBJECT_TYPE_STR[AMP_VALUE_TYPE (obj)],
                   AMP_OBJECT_TYPE_STR[AMP_OBJECT_STRING]);
           exit(EXIT_FAILURE);
         }
@@ -244,7 +175,7 @@ ample_cast_object_to_integer (ASTHandle *restrict args,
       ret_object = AmpNumberCreate ((int)(val));
     } break;
     case AMP_OBJECT_BOOL: {
-      int num = AMP_BOOL (obj)->val;
+      int num = AMP_VALUE_TO_BOOL (obj);
       /* clamp the number to 0 or 1 */
       if (num > 0)
         num = 1;
@@ -252,42 +183,60 @@ ample_cast_object_to_integer (ASTHandle *restrict args,
     } break;
     default:
       printf (ample_error_codes[ERROR_INVALID_CAST],
-              AMP_OBJECT_TYPE_STR[obj->info->type],
+              AMP_OBJECT_TYPE_STR[AMP_VALUE_TYPE (obj)],
               AMP_OBJECT_TYPE_STR[AMP_OBJECT_NUMBER]);
       exit (1);
     }
-  AmpObjectDecrementRefcount (obj);
   return ret_object;
 }
 
-AmpObject *
-ample_cast_object_to_bool (ASTHandle *restrict args,
-                           size_t arg_count,
-                           const char *restrict func_name,
-                           DICT (ObjVars) **restrict variable_scope_stack)
+
+AmpValue
+ample_object_to_bool (AmpValue obj)
 {
-  AmpObject *obj, *ret_object = NULL;
-  ample_function_check_arg_numbers (arg_count, 1, func_name);
-  /* get the argument */
-  obj = InterpreterGetOrGenerateAmpObject (args[0],
-                                           variable_scope_stack);
-  switch (obj->info->type)
+  AmpValue ret_object = AMP_VALUE_EMPTY;
+  switch (AMP_VALUE_TYPE (obj))
     {
     case AMP_OBJECT_BOOL: {
-      ret_object = AmpBoolCreate (AMP_BOOL (obj)->val);
+      ret_object = obj;
     } break;
     case AMP_OBJECT_NUMBER: {
-      bool32 val = (bool32) AMP_NUMBER (obj)->val;
+      bool32 val = (bool32) AMP_VALUE_TO_NUMBER (obj);
       if (val > 0)
         val = 1;
       ret_object = AmpBoolCreate (val);
     } break;
     default:
       printf (ample_error_codes[ERROR_INVALID_CAST],
-              AMP_OBJECT_TYPE_STR[obj->info->type],
+              AMP_OBJECT_TYPE_STR[AMP_VALUE_TYPE (obj)],
               AMP_OBJECT_TYPE_STR[AMP_OBJECT_NUMBER]);
       exit (EXIT_FAILURE);
     }
-  AmpObjectDecrementRefcount (obj);
   return ret_object;
 }
+
+AmpValue
+ample_builtin_print (AmpValue *args)
+{
+  ample_print_object (args[0]);
+  printf ("\n");
+  return AMP_VALUE_EMPTY;
+}
+
+AmpValue
+ample_builtin_str (AmpValue *args)
+{
+  return ample_object_to_string (args[0]);
+}
+
+AmpValue
+ample_builtin_int (AmpValue *args)
+{
+  return ample_object_to_integer (args[0]);
+}
+
+AmpValue
+ample_builtin_bool (AmpValue *args)
+{
+  return ample_object_to_bool (args[0]);
+}
@@ -17,37 +17,59 @@
 #ifndef INTERPRETER_FUNCTIONS_H_
 #define INTERPRETER_FUNCTIONS_H_
 #include "ast.h"
-bool32 ExecuteAmpleFunction (ASTHandle  *restrict args,
-                             size_t arg_count,
-                             const char *restrict func_name,
-                             DICT (ObjVars) **restrict variable_scope_stack,
-                             AmpObject **ret_object,
-                             bool32 *return_from_scope);
+/* The language defined functions.
+ * X(id, name, argument count, function)
+ * A call's builtin is found by its exact name when it's parsed.
+ * return takes 0 or 1 arguments and is run by the tree walker and
+ * the compiler themselves, so it has no function */
+#define AMPLE_BUILTINS                                                         \
+  X(AMPLE_BUILTIN_PRINT, "print", 1, ample_builtin_print)                      \
+  X(AMPLE_BUILTIN_STR, "str", 1, ample_builtin_str)                            \
+  X(AMPLE_BUILTIN_INT, "int", 1, ample_builtin_int)                            \
+  X(AMPLE_BUILTIN_BOOL, "bool", 1, ample_builtin_bool)                         \
+  X(AMPLE_BUILTIN_RETURN, "return", 1, NULL)
+#define X(id, name, arg_count, function) id,
+typedef enum AmpleBuiltinId {
+  AMPLE_BUILTINS
+  AMPLE_BUILTIN_NONE /* not the name of a builtin */
+} AmpleBuiltinId;
+#undef X
+
+/* args are borrowed, the returned value is owned by the caller */
+typedef AmpValue (*AmpleBuiltinFunction)(AmpValue *args);
+struct AmpleBuiltin {
+  const char *name;
+  unsigned int arg_count;
+  AmpleBuiltinFunction function;
+};
+extern const struct AmpleBuiltin AMPLE_BUILTIN_TABLE[];
+
+/* ******************
+   External functions
+   ****************** */
+AmpleBuiltinId AmpleBuiltinFind(const char *name);
+/* runs a builtin other than return on arguments that have already
+ * been evaluated. The arguments are borrowed */
+AmpValue AmpleBuiltinCall(AmpleBuiltinId id,
+                          AmpValue *args,
+                          size_t arg_count);
+
+/* ******************
+   Internal Functions
+   ****************** */
 void
 ample_function_check_arg_numbers (size_t count,
                                   size_t expected_count,
                                   const char *func_name);
-void ample_print (ASTHandle  *restrict args,
-                  size_t arg_count,
-                  const char *restrict func_name,
-                  DICT (ObjVars) **restrict variable_scope_stack);
-AmpObject *
-ample_cast_object_to_string (ASTHandle *restrict args,
-                             size_t arg_count,
-                             const char *restrict func_name,
-                             DICT (ObjVars) **restrict variable_scope_stack);
-/* cast to create an integer. 
- * This will throw away any decimal and just return the integer part of
+void ample_print_object (AmpValue obj);
+/* the object casts return a new reference and leave obj untouched */
+AmpValue ample_object_to_string (AmpValue obj);
+/* This will throw away any decimal and just return the integer part of
  * a number */
-AmpObject *
-ample_cast_object_to_integer (ASTHandle *restrict args,
-                              size_t arg_count,
-                              const char *restrict func_name,
-                              DICT (ObjVars) **restrict variable_scope_stack);
-AmpObject *
-ample_cast_object_to_bool (ASTHandle *restrict args,
-                           size_t arg_count,
-                           const char *restrict func_name,
-                           DICT (ObjVars) **restrict variable_scope_stack);
+AmpValue ample_object_to_integer (AmpValue obj);
+AmpValue ample_object_to_bool (AmpValue obj);
+AmpValue ample_builtin_print (AmpValue *args);
+AmpValue ample_builtin_str (AmpValue *args);
+AmpValue ample_builtin_int (AmpValue *args);
+AmpValue ample_builtin_bool (AmpValue *args);
 #endif
-
@@ -16,118 +16,369 @@
 */
 #include "array.h"
 #include "lexer.h"
-#include "ssl.h"
-#include <ctype.h>
+#include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-struct Token *
-LexAll (char *fb)
+#if (defined(__GNUC__) || defined(__clang__))                                  \
+    && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64))
+#define LEXER_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__)
+/* only gcc style builds can check for avx2 at runtime */
+#define LEXER_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+static unsigned char lexer_char_class[256];
+static bool32 lexer_initialized;
+static size_t (*lexer_span_whitespace) (const char *fb,
+                                        size_t length,
+                                        size_t i);
+static size_t (*lexer_span_identifier) (const char *fb,
+                                        size_t length,
+                                        size_t i);
+
+void
+lexer_init (void)
 {
-  struct Token *tokens = NULL;
-  size_t i = 0;
-  char c = fb[i++];
+  unsigned int c;
+  if (lexer_initialized)
+    return;
+  /* the same classes isspace, isalpha and isdigit
+   * give in the "C" locale */
+  for (c = 0; c < 256; c++)
+    {
+      unsigned char class = 0;
+      if (c == ' ' || (c >= '\t' && c <= '\r'))
+        class |= LEXER_SPACE;
+      if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+        class |= LEXER_ALPHA | LEXER_IDENTIFIER;
+      if (c >= '0' && c <= '9')
+        class |= LEXER_DIGIT | LEXER_IDENTIFIER | LEXER_NUMBER;
+      if (c == '_' || c == '-')
+        class |= LEXER_IDENTIFIER;
+      if (c == '.')
+        class |= LEXER_NUMBER;
+      if (c && strchr (LEXER_PUNCTUATORS, (int) c))
+        class |= LEXER_PUNCTUATOR;
+      lexer_char_class[c] = class;
+    }
 
-  while (c != '\0')
+  lexer_span_whitespace = lexer_span_whitespace_scalar;
+  lexer_span_identifier = lexer_span_identifier_scalar;
+#ifdef LEXER_SSE2
+  lexer_span_whitespace = lexer_span_whitespace_sse2;
+  lexer_span_identifier = lexer_span_identifier_sse2;
+#endif
+#ifdef LEXER_AVX2
+  if (__builtin_cpu_supports ("avx2"))
     {
-      struct Token token = { 0 };
-      /* Remove any leading spaces */
-      while (isspace (c))
+      lexer_span_whitespace = lexer_span_whitespace_avx2;
+      lexer_span_identifier = lexer_span_identifier_avx2;
+    }
+#endif
+  lexer_initialized = true;
+}
+
+size_t
+lexer_span_class (const char *fb, size_t length, size_t i, unsigned char class)
+{
+  while (i < length && (lexer_char_class[(unsigned char) fb[i]] & class))
+    i++;
+  return i;
+}
+
+size_t
+lexer_span_whitespace_scalar (const char *fb, size_t length, size_t i)
+{
+  return lexer_span_class (fb, length, i, LEXER_SPACE);
+}
+
+size_t
+lexer_span_identifier_scalar (const char *fb, size_t length, size_t i)
+{
+  return lexer_span_class (fb, length, i, LEXER_IDENTIFIER);
+}
+
+#ifdef LEXER_SSE2
+/* the vector versions test a whole block at a time and fall back to
+ * the table for the tail of the buffer that is too short for a load */
+static inline __m128i
+lexer_in_range_sse2 (__m128i bytes, char low, char high)
+{
+  /* bytes - low <= high - low, as unsigned bytes */
+  __m128i offset = _mm_sub_epi8 (bytes, _mm_set1_epi8 (low));
+  __m128i limit = _mm_set1_epi8 ((char) (high - low));
+  return _mm_cmpeq_epi8 (_mm_min_epu8 (offset, limit), offset);
+}
+
+size_t
+lexer_span_whitespace_sse2 (const char *fb, size_t length, size_t i)
+{
+  while (i + 16 <= length)
+    {
+      __m128i bytes = _mm_loadu_si128 ((const __m128i *) (fb + i));
+      __m128i space = _mm_or_si128 (_mm_cmpeq_epi8 (bytes,
+                                                    _mm_set1_epi8 (' ')),
+                                    lexer_in_range_sse2 (bytes, '\t', '\r'));
+      unsigned int mask = ~_mm_movemask_epi8 (space) & 0xFFFF;
+      if (mask)
+        return i + __builtin_ctz (mask);
+      i += 16;
+    }
+  return lexer_span_whitespace_scalar (fb, length, i);
+}
+
+size_t
+lexer_span_identifier_sse2 (const char *fb, size_t length, size_t i)
+{
+  while (i + 16 <= length)
+    {
+      __m128i bytes = _mm_loadu_si128 ((const __m128i *) (fb + i));
+      /* setting 0x20 folds upper case letters onto lower case */
+      __m128i lower = _mm_or_si128 (bytes, _mm_set1_epi8 (0x20));
+      __m128i ident = _mm_or_si128 (lexer_in_range_sse2 (lower, 'a', 'z'),
+                                    lexer_in_range_sse2 (bytes, '0', '9'));
+      unsigned int mask;
+      ident = _mm_or_si128 (ident,
+                            _mm_cmpeq_epi8 (bytes, _mm_set1_epi8 ('_')));
+      ident = _mm_or_si128 (ident,
+                            _mm_cmpeq_epi8 (bytes, _mm_set1_epi8 ('-')));
+      mask = ~_mm_movemask_epi8 (ident) & 0xFFFF;
+      if (mask)
+        return i + __builtin_ctz (mask);
+      i += 16;
+    }
+  return lexer_span_identifier_scalar (fb, length, i);
+}
+#endif
+
+#ifdef LEXER_AVX2
+__attribute__ ((target ("avx2"))) static inline __m256i
+lexer_in_range_avx2 (__m256i bytes, char low, char high)
+{
+  __m256i offset = _mm256_sub_epi8 (bytes, _mm256_set1_epi8 (low));
+  __m256i limit = _mm256_set1_epi8 ((char) (high - low));
+  return _mm256_cmpeq_epi8 (_mm256_min_epu8 (offset, limit), offset);
+}
+
+__attribute__ ((target ("avx2"))) size_t
+lexer_span_whitespace_avx2 (const char *fb, size_t length, size_t i)
+{
+  while (i + 32 <= length)
+    {
+      __m256i bytes = _mm256_loadu_si256 ((const __m256i *) (fb + i));
+      __m256i blank = _mm256_cmpeq_epi8 (bytes, _mm256_set1_epi8 (' '));
+      __m256i space = _mm256_or_si256 (blank,
+                                       lexer_in_range_avx2 (bytes, '\t', '\r'));
+      unsigned int mask = ~(unsigned int) _mm256_movemask_epi8 (space);
+      if (mask)
+        return i + __builtin_ctz (mask);
+      i += 32;
+    }
+  return lexer_span_whitespace_sse2 (fb, length, i);
+}
+
+__attribute__ ((target ("avx2"))) size_t
+lexer_span_identifier_avx2 (const char *fb, size_t length, size_t i)
+{
+  while (i + 32 <= length)
+    {
+      __m256i bytes = _mm256_loadu_si256 ((const __m256i *) (fb + i));
+      __m256i lower = _mm256_or_si256 (bytes, _mm256_set1_epi8 (0x20));
+      __m256i ident = _mm256_or_si256 (lexer_in_range_avx2 (lower, 'a', 'z'),
+                                       lexer_in_range_avx2 (bytes, '0', '9'));
+      unsigned int mask;
+      ident = _mm256_or_si256 (ident,
+                               _mm256_cmpeq_epi8 (bytes,
+                                                  _mm256_set1_epi8 ('_')));
+      ident = _mm256_or_si256 (ident,
+                               _mm256_cmpeq_epi8 (bytes,
+                                                  _mm256_set1_epi8 ('-')));
+      mask = ~(unsigned int) _mm256_movemask_epi8 (ident);
+      if (mask)
+        return i + __builtin_ctz (mask);
+      i += 32;
+    }
+  return lexer_span_identifier_sse2 (fb, length, i);
+}
+#endif
+
+/* one probe into a collision free table, see LEXER_KEYWORD_HASH */
+#define X(name, length, first, last, value)                                    \
+  [LEXER_KEYWORD_HASH (length, first, last)] = { name, length, value },
+static const struct LexerKeyword lexer_keywords[LEXER_KEYWORD_TABLE_SIZE] = {
+  LEXER_KEYWORDS
+};
+#undef X
+
+TValue
+lexer_keyword (const char *id, size_t id_length)
+{
+  const struct LexerKeyword *keyword;
+  unsigned char first = id[0];
+  unsigned char last = id[id_length - 1];
+  if (id_length < 2 || id_length > LEXER_KEYWORD_MAX_LENGTH)
+    return TOK_IDENTIFIER;
+  keyword = &lexer_keywords[LEXER_KEYWORD_HASH (id_length, first, last)];
+  if (keyword->length == id_length
+      && 0 == memcmp (keyword->name, id, id_length))
+    return keyword->value;
+  return TOK_IDENTIFIER;
+}
+
+void
+lexer_push_token (struct TokenStream *tokens,
+                  TValue kind,
+                  size_t start,
+                  size_t length)
+{
+  size_t i = tokens->count;
+  /* a raw byte that isn't a punctuator could pass for a named kind */
+  assert (kind >= TOK_IDENTIFIER
+          || (lexer_char_class[kind] & LEXER_PUNCTUATOR));
+  if (i == tokens->capacity)
+    {
+      size_t capacity = tokens->capacity ? tokens->capacity * 2 : 256;
+      if (tokens->kinds)
         {
-          c = fb[i++];
+          tokens->kinds = realloc (tokens->kinds,
+                                   capacity * sizeof (*tokens->kinds));
+          tokens->starts = realloc (tokens->starts,
+                                    capacity * sizeof (*tokens->starts));
+          tokens->lengths = realloc (tokens->lengths,
+                                     capacity * sizeof (*tokens->lengths));
         }
-      /* in case we hit eof after newline */
-      if (c == '\0')
+      else
+        {
+          tokens->kinds = malloc (capacity * sizeof (*tokens->kinds));
+          tokens->starts = malloc (capacity * sizeof (*tokens->starts));
+          tokens->lengths = malloc (capacity * sizeof (*tokens->lengths));
+        }
+      tokens->capacity = capacity;
+    }
+  tokens->kinds[i] = (unsigned char) kind;
+  tokens->starts[i] = (unsigned int) start;
+  if (length < TOKEN_LONG_LENGTH)
+    {
+      tokens->lengths[i] = (unsigned short) length;
+    }
+  else
+    {
+      struct TokenLongLength long_length;
+      long_length.token = (unsigned int) i;
+      long_length.length = (unsigned int) length;
+      tokens->lengths[i] = TOKEN_LONG_LENGTH;
+      ARRAY_PUSH (tokens->long_lengths, long_length);
+    }
+  tokens->count++;
+}
+
+struct TokenStream
+LexAll (const char *fb, size_t length)
+{
+  struct TokenStream tokens = { 0 };
+  size_t i = 0;
+  lexer_init ();
+  if (length > 0xFFFFFFFF)
+    {
+      printf ("Scripts can't be larger than 4GB\n");
+      exit (1);
+    }
+
+  for (;;)
+    {
+      size_t start;
+      TValue kind;
+      unsigned char c;
+      unsigned char class;
+      /* Remove any leading spaces */
+      i = lexer_span_whitespace (fb, length, i);
+      if (i >= length || fb[i] == '\0')
         break;
-      if (isalpha (c))
+      c = fb[i];
+      class = lexer_char_class[c];
+      start = i;
+      if (class & LEXER_ALPHA)
         { /* IDENTIFIER */
-          char *id = NULL;
-          id = ssl_addchar (id, c);
-          c = fb[i++]; /* get the next char to not add starting char twice */
-          while (isalpha (c) || isdigit (c) || c == '_' || c == '-')
-            {
-              id = ssl_addchar (id, c);
-              c = fb[i++];
-            }
-          i--;
-
-          token.string = id;
-          if (0 == strncmp ("true", id, ssl_strlen (id)))
-            {
-              token.value = TOK_BOOL;
-            }
-          else if (0 == strncmp ("false", id, ssl_strlen (id)))
-            {
-              token.value = TOK_BOOL;
-            }
-          else if (0 == strncmp ("if", id, ssl_strlen (id)))
-            {
-              token.value = TOK_IF;
-            }
-          else if (0 == strncmp("else", id, 4))
-            {
-              token.value = TOK_ELSE;
-            }
-          else if (0 == strncmp ("func", id, 4))
-            {
-              token.value = TOK_FUNC;
-            }
-          else
-            {
-              token.value = TOK_IDENTIFIER;
-            }
+          i = lexer_span_identifier (fb, length, i + 1);
+          kind = lexer_keyword (fb + start, i - start);
         }
-      else if (isdigit (c))
+      else if (class & LEXER_DIGIT)
         { /* INTEGER */
-          char *num = ssl_addchar (NULL, c);
-          c = fb[i++];
-          while (isdigit (c) || c == '.')
-            {
-              num = ssl_addchar (num, c);
-              c = fb[i++];
-            }
-          i--;
-
-          token.string = num;
-          token.value = TOK_INTEGER;
+          i = lexer_span_class (fb, length, i + 1, LEXER_NUMBER);
+          kind = TOK_INTEGER;
         }
       else if (c == '"')
-        { /* STRING */
-          char *str = NULL;
-          c = fb[i++];
-          while (c != '"')
+        { /* STRING, the span leaves out the quotes */
+          const char *end = memchr (fb + i + 1, '"', length - i - 1);
+          if (!end)
             {
-              str = ssl_addchar (str, c);
-              c = fb[i++];
+              printf ("Unterminated string literal\n");
+              exit (1);
             }
-          token.string = str;
-          token.value = TOK_STRING;
+          start = i + 1;
+          lexer_push_token (&tokens, TOK_STRING, start, end - (fb + start));
+          i = end - fb + 1;
+          continue;
         }
       else if (c == '#')
         {
           /* comment, so skip the entire line */
-          while (c != '\n')
-            c = fb[i++];
+          const char *end = memchr (fb + i, '\n', length - i);
+          i = end ? (size_t) (end - fb) + 1 : length;
           continue;
         }
+      else if (class & LEXER_PUNCTUATOR)
+        {
+          kind = c;
+          i++;
+        }
       else
-        { /* Any other kind of ASCII token */
-          token.value = c;
+        {
+          if (c >= ' ' && c < 0x7F)
+            printf ("Unexpected character '%c' in script\n", c);
+          else
+            printf ("Unexpected byte 0x%02X in script\n", c);
+          exit (1);
         }
-      c = fb[i++];
-      ARRAY_PUSH (tokens, token);
+      lexer_push_token (&tokens, kind, start, i - start);
     }
   return tokens;
 }
 
-void
-TokenFreeAll (struct Token *tokens)
+unsigned int
+TokenLength (const struct TokenStream *tokens, size_t token)
 {
-  size_t count = ARRAY_COUNT (tokens);
-  size_t i;
-  for (i = 0; i < count; i++)
+  size_t low = 0;
+  size_t high = ARRAY_COUNT (tokens->long_lengths);
+  if (tokens->lengths[token] != TOKEN_LONG_LENGTH)
+    return tokens->lengths[token];
+  while (low < high)
     {
-      if (tokens[i].string)
-        ssl_free (tokens[i].string);
+      size_t mid = low + (high - low) / 2;
+      if (tokens->long_lengths[mid].token < token)
+        low = mid + 1;
+      else
+        high = mid;
     }
-  ARRAY_FREE (tokens);
+  return tokens->long_lengths[low].length;
+}
+
+void
+TokenStreamFree (struct TokenStream *tokens)
+{
+  free (tokens->kinds);
+  free (tokens->starts);
+  free (tokens->lengths);
+  ARRAY_FREE (tokens->long_lengths);
+  tokens->kinds = NULL;
+  tokens->starts = NULL;
+  tokens->lengths = NULL;
+  tokens->long_lengths = NULL;
+  tokens->count = 0;
+  tokens->capacity = 0;
 }
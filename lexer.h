@@ -16,6 +16,8 @@
 */
 #ifndef LEXER_H_
 #define LEXER_H_
+#include "bool.h"
+#include <stddef.h>
 #include <stdio.h>
 /* starts with the last ascii value */
 /* ascii values can be represented as tokens just by their value */
@@ -30,14 +32,89 @@ typedef enum {
   TOK_STRING = 130,
   TOK_IF = 131,
   TOK_ELSE = 132,
-  TOK_FUNC = 133
+  TOK_FUNC = 133,
+  TOK_WHILE = 134,
+  TOK_FOR = 135,
+  TOK_LAST = TOK_FOR
 } TValue;
-struct Token {
-  TValue value;
-  char *string; /* ssl managed string */
+/* The tokens of a script, split into parallel arrays so scanning the
+ * kinds stays in cache. Tokens point back into the source they were
+ * lexed from, a string token's span leaves out the quotes.
+ * Lengths that don't fit in 16 bits are kept in a side table */
+struct TokenStream {
+  /* TValue of each token. A punctuator's kind is its byte, they are all
+   * ASCII below TOK_IDENTIFIER so they never overlap the named kinds */
+  unsigned char *kinds;
+  unsigned int *starts;    /* offset into the source */
+  unsigned short *lengths; /* TOKEN_LONG_LENGTH for long tokens */
+  struct TokenLongLength *long_lengths; /* sb array, sorted by token */
+  size_t count;
+  size_t capacity;
+};
+#define TOKEN_LONG_LENGTH 0xFFFF
+/* fails to compile if a named kind stops fitting in a byte */
+typedef char token_kind_fits_in_a_byte[TOK_LAST <= 0xFF ? 1 : -1];
+struct TokenLongLength {
+  unsigned int token;
+  unsigned int length;
 };
 
-void TokenFreeAll(struct Token *tokens);
-struct Token *LexAll(char *fb);
+void TokenStreamFree(struct TokenStream *tokens);
+unsigned int TokenLength(const struct TokenStream *tokens, size_t token);
+/* lexes length bytes of fb, which doesn't need a NUL terminator.
+ * fb has to stay alive until the tokens are parsed */
+struct TokenStream LexAll(const char *fb, size_t length);
+
+/* ******************
+ * internal functions
+ * ****************** */
+/* character classes, bits of lexer_char_class */
+#define LEXER_SPACE 1
+#define LEXER_ALPHA 2
+#define LEXER_DIGIT 4
+#define LEXER_IDENTIFIER 8 /* can continue an identifier */
+#define LEXER_NUMBER 16    /* can continue a number */
+#define LEXER_PUNCTUATOR 32 /* a token of its own, its kind is the byte */
+#define LEXER_PUNCTUATORS "!()*+,-/;<=>[]{}"
+/* fills the class table and picks the widest scanners the cpu runs */
+void lexer_init(void);
+/* the span functions return the index of the first byte at or after i
+ * that isn't part of the run */
+size_t lexer_span_class(const char *fb, size_t length, size_t i,
+                        unsigned char class);
+size_t lexer_span_whitespace_scalar(const char *fb, size_t length, size_t i);
+size_t lexer_span_identifier_scalar(const char *fb, size_t length, size_t i);
+size_t lexer_span_whitespace_sse2(const char *fb, size_t length, size_t i);
+size_t lexer_span_identifier_sse2(const char *fb, size_t length, size_t i);
+size_t lexer_span_whitespace_avx2(const char *fb, size_t length, size_t i);
+size_t lexer_span_identifier_avx2(const char *fb, size_t length, size_t i);
+
+/* X(name, length, first char, last char, token) */
+#define LEXER_KEYWORDS                                                         \
+  X("true", 4, 't', 'e', TOK_BOOL)                                             \
+  X("false", 5, 'f', 'e', TOK_BOOL)                                            \
+  X("if", 2, 'i', 'f', TOK_IF)                                                 \
+  X("else", 4, 'e', 'e', TOK_ELSE)                                             \
+  X("func", 4, 'f', 'c', TOK_FUNC)                                             \
+  X("while", 5, 'w', 'e', TOK_WHILE)                                           \
+  X("for", 3, 'f', 'r', TOK_FOR)
+#define LEXER_KEYWORD_MAX_LENGTH 5
+/* A perfect hash of the keywords. Two keywords landing in the same slot
+ * initialize it twice, which the compiler warns about (-Woverride-init),
+ * so pick other multipliers when adding a keyword collides */
+#define LEXER_KEYWORD_TABLE_SIZE 16
+#define LEXER_KEYWORD_HASH(length, first, last)                                \
+  (((first) + 2 * (last) + (length)) & (LEXER_KEYWORD_TABLE_SIZE - 1))
+struct LexerKeyword {
+  const char *name;
+  size_t length; /* 0 for an empty slot */
+  TValue value;
+};
+/* the keyword token of an identifier or TOK_IDENTIFIER */
+TValue lexer_keyword(const char *id, size_t id_length);
+void lexer_push_token(struct TokenStream *tokens,
+                      TValue kind,
+                      size_t start,
+                      size_t length);
 
 #endif
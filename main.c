@@ -16,51 +16,225 @@
 */
 #include "mem_debug.h"
 #include "ast.h"
+#include "ast_cache.h"
 #include "lexer.h"
 #include "parser.h"
+#include "optimizer.h"
+#include "symbol.h"
 #include "interpreter.h"
+#include "compiler.h"
+#include "vm.h"
+#include "objects/ampobject.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-char *
-read_whole_file (FILE *f)
+/* megabytes the calls of a script may take up. Calls don't run on the
+ * C stack, so this is all that limits how deep a script can recurse */
+#define AMPLE_DEFAULT_STACK_LIMIT 256u
+
+/* the script being run, either mapped or read into memory */
+struct SourceFile {
+  char *data;
+  size_t length;
+  bool32 mapped;
+};
+
+/* reads the whole stream, works for pipes which can't be seeked */
+void
+source_file_read (FILE *f, struct SourceFile *source)
 {
-  size_t fsize;
-  char* file;
+  size_t capacity = 4096;
   size_t size_read;
+  source->data = malloc (capacity);
+  source->length = 0;
+  source->mapped = false;
+  while ((size_read = fread (source->data + source->length,
+                             1,
+                             capacity - source->length,
+                             f)) > 0)
+    {
+      source->length += size_read;
+      if (source->length == capacity)
+        {
+          capacity *= 2;
+          source->data = realloc (source->data, capacity);
+        }
+    }
+}
 
-  fseek (f, 0, SEEK_END);
-  fsize = ftell (f);
-  fseek (f, 0, SEEK_SET);
+/* "-" is stdin. Regular files are mapped so lexing can start on
+ * whatever is in the page cache without copying the file first */
+bool32
+source_file_open (const char *file_name, struct SourceFile *source)
+{
+  FILE *f;
+#ifndef _WIN32
+  int fd;
+  struct stat st;
+  if (0 == strcmp (file_name, "-"))
+    {
+      source_file_read (stdin, source);
+      return true;
+    }
+  fd = open (file_name, O_RDONLY);
+  if (fd < 0)
+    return false;
+  if (fstat (fd, &st) == 0 && S_ISREG (st.st_mode) && st.st_size > 0)
+    {
+      void *data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED)
+        {
+          madvise (data, st.st_size, MADV_SEQUENTIAL);
+          close (fd);
+          source->data = data;
+          source->length = st.st_size;
+          source->mapped = true;
+          return true;
+        }
+    }
+  close (fd);
+#else
+  if (0 == strcmp (file_name, "-"))
+    {
+      source_file_read (stdin, source);
+      return true;
+    }
+#endif
+  f = fopen (file_name, "rb");
+  if (!f)
+    return false;
+  source_file_read (f, source);
+  fclose (f);
+  return true;
+}
 
-  file = malloc (fsize + 1);
-  size_read = fread (file, 1, fsize, f);
-  assert (size_read <= fsize);
+void
+source_file_close (struct SourceFile *source)
+{
+#ifndef _WIN32
+  if (source->mapped)
+    {
+      munmap (source->data, source->length);
+      return;
+    }
+#endif
+  free (source->data);
+}
 
-  file[size_read] = '\0';
-  return file;
+void
+print_usage (const char *program)
+{
+  printf ("usage: %s [--tree-walker] [--cache] [--stack-limit MB] file\n",
+          program);
+  printf ("  file           the script to run, - reads it from stdin\n");
+  printf ("  --tree-walker  evaluate the syntax tree directly instead of\n");
+  printf ("                 compiling it to bytecode first\n");
+  printf ("  --cache        keep the parsed script in file.astc and use\n");
+  printf ("                 it while the script is unchanged\n");
+  printf ("  --stack-limit  how many megabytes the calls being run may take\n");
+  printf ("                 up, deeper recursion is a stack overflow\n");
+  printf ("                 (default %u)\n", AMPLE_DEFAULT_STACK_LIMIT);
 }
 
 int
 main (int argc, char **argv)
 {
-  if (argc > 1)
+  const char *file_name = NULL;
+  bool32 use_tree_walker = false;
+  bool32 use_cache = false;
+  size_t stack_limit = (size_t) AMPLE_DEFAULT_STACK_LIMIT << 20;
+  int i;
+  for (i = 1; i < argc; i++)
     {
-      struct Token *tokens;
-      ASTHandle ast_head;
-      FILE *f = fopen (argv[1], "r");
-      char *file = read_whole_file (f);
-      fclose (f);
+      if (0 == strcmp (argv[i], "--tree-walker"))
+        {
+          use_tree_walker = true;
+        }
+      else if (0 == strcmp (argv[i], "--cache"))
+        {
+          use_cache = true;
+        }
+      else if (0 == strcmp (argv[i], "--stack-limit") && i + 1 < argc)
+        {
+          char *end;
+          unsigned long megabytes = strtoul (argv[++i], &end, 10);
+          if (*end != '\0' || megabytes == 0)
+            {
+              print_usage (argv[0]);
+              return 1;
+            }
+          stack_limit = (size_t) megabytes << 20;
+        }
+      else if (argv[i][0] == '-' && argv[i][1] != '\0')
+        {
+          print_usage (argv[0]);
+          return 1;
+        }
+      else
+        {
+          file_name = argv[i];
+        }
+    }
 
-      tokens = LexAll (file);
-      free (file);
+  if (file_name)
+    {
+      struct TokenStream tokens;
+      ASTHandle ast_head;
+      struct SourceFile source;
+      char *cache_name = NULL;
+      if (!source_file_open (file_name, &source))
+        {
+          printf ("Unable to open file: %s\n", file_name);
+          return 1;
+        }
 
-      ast_head = ParseTokens (tokens);
-      InterpreterStart (ast_head);
+      if (use_cache && 0 != strcmp (file_name, "-"))
+        {
+          cache_name = malloc (strlen (file_name) + sizeof (".astc"));
+          strcpy (cache_name, file_name);
+          strcat (cache_name, ".astc");
+        }
+      if (!cache_name || !ASTCacheLoad (cache_name,
+                                        source.data,
+                                        source.length,
+                                        &ast_head))
+        {
+          tokens = LexAll (source.data, source.length);
+          ast_head = ParseTokens (source.data, &tokens);
+          TokenStreamFree (&tokens);
+          OptimizeProgram (ast_head);
+          /* failing to write it only costs the next run a parse */
+          if (cache_name)
+            ASTCacheStore (cache_name, source.data, source.length, ast_head);
+        }
+      free (cache_name);
+      source_file_close (&source);
+      if (use_tree_walker)
+        {
+          InterpreterStart (ast_head, stack_limit);
+        }
+      else
+        {
+          struct BytecodeFunction *program = CompileProgram (ast_head);
+          VMRun (program, stack_limit);
+          BytecodeFunctionFree (program);
+        }
 
       ast_free_buffer ();
-      TokenFreeAll (tokens);
+      ASTCacheClose ();
+      SymbolTableFree ();
+#ifdef ALLOCATOR_DEBUG
+      AmpObjectAllocatorPrintStats ();
+#endif
+      AmpObjectAllocatorRelease ();
 
       printf ("Memory after program completion...\n");
       MemDebugPrintInfo ();
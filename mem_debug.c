@@ -43,7 +43,11 @@ debug_malloc (size_t size, const char *file, int line)
 void
 debug_free (void *ptr)
 {
-  MemInfo *info = (MemInfo *) (((char*) ptr) - offsetof (MemInfo, mem));
+  MemInfo *info;
+  /* same as free, NULL is allowed */
+  if (!ptr)
+    return;
+  info = (MemInfo *) (((char*) ptr) - offsetof (MemInfo, mem));
   currently_allocated -= info->allocation_size;
   allocations[info->unique_id] = NULL;
   free (info->file);
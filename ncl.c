@@ -33,7 +33,7 @@ ncl_realloc (void *p, size_t s)
 char *
 NCL_DoubleToString(double num)
 {
-  size_t alloc_size = snprintf (NULL, 0, "%f", num);
+  size_t alloc_size = snprintf (NULL, 0, "%f", num) + 1;
   char *ret = malloc (alloc_size);
   sprintf (ret, "%f", num);
   return ret;
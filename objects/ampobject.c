@@ -15,24 +15,150 @@
     along with Ample.  If not, see <https://www.gnu.org/licenses/>.
 */
 #include "ampobject.h"
+#include "numobject.h"
+#include "boolobject.h"
 #include "../ample_errors.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+struct AmpFreeObject {
+  struct AmpFreeObject *next;
+};
+/* slabs are chained through their first bytes so they can be freed,
+ * the objects start one granule in to stay aligned */
+struct AmpSlab {
+  struct AmpSlab *next;
+};
+
+static struct AmpFreeObject *amp_freelists[AMP_ALLOCATOR_CLASS_COUNT];
+static struct AmpSlab *amp_slabs;
+static AmpAllocatorStats amp_allocator_stats;
+
+void
+amp_allocator_refill (unsigned int size_class)
+{
+  size_t object_size = (size_class + 1) * AMP_ALLOCATOR_GRANULE;
+  struct AmpSlab *slab = malloc (AMP_ALLOCATOR_SLAB_SIZE);
+  char *object = (char *) slab + AMP_ALLOCATOR_GRANULE;
+  char *end = (char *) slab + AMP_ALLOCATOR_SLAB_SIZE;
+
+  slab->next = amp_slabs;
+  amp_slabs = slab;
+  amp_allocator_stats.slabs++;
+  for (; object + object_size <= end; object += object_size)
+    {
+      struct AmpFreeObject *free_object = (struct AmpFreeObject *) object;
+      free_object->next = amp_freelists[size_class];
+      amp_freelists[size_class] = free_object;
+    }
+}
+
+AmpObject *
+AmpObjectAllocate (size_t size)
+{
+  AmpObject *obj;
+  unsigned int size_class;
+  amp_allocator_stats.allocations++;
+  if (size > AMP_ALLOCATOR_MAX_SIZE)
+    {
+      amp_allocator_stats.large_allocations++;
+      obj = malloc (size);
+      obj->size_class = AMP_ALLOCATOR_LARGE;
+      return obj;
+    }
+
+  size_class = (size + AMP_ALLOCATOR_GRANULE - 1) / AMP_ALLOCATOR_GRANULE - 1;
+  if (amp_freelists[size_class])
+    amp_allocator_stats.freelist_hits++;
+  else
+    amp_allocator_refill (size_class);
+  obj = (AmpObject *) amp_freelists[size_class];
+  amp_freelists[size_class] = amp_freelists[size_class]->next;
+  obj->size_class = size_class;
+  return obj;
+}
+
+AmpObject *
+AmpObjectResize (AmpObject *obj, size_t size)
+{
+  AmpObject *resized;
+  size_t old_size;
+  unsigned int size_class;
+  if (obj->size_class == AMP_ALLOCATOR_LARGE)
+    return realloc (obj, size);
+  old_size = (obj->size_class + 1) * AMP_ALLOCATOR_GRANULE;
+  if (size <= old_size)
+    return obj;
+
+  resized = AmpObjectAllocate (size);
+  size_class = resized->size_class;
+  memcpy (resized, obj, old_size);
+  resized->size_class = size_class;
+  AmpObjectDestroyBasic (obj);
+  return resized;
+}
+
 void
 AmpObjectDestroyBasic (AmpObject *obj)
 {
-  free (obj);
+  struct AmpFreeObject *free_object = (struct AmpFreeObject *) obj;
+  unsigned int size_class = obj->size_class;
+  if (size_class == AMP_ALLOCATOR_LARGE)
+    {
+      free (obj);
+      return;
+    }
+  free_object->next = amp_freelists[size_class];
+  amp_freelists[size_class] = free_object;
+}
+
+void
+AmpObjectAllocatorRelease (void)
+{
+  while (amp_slabs)
+    {
+      struct AmpSlab *next = amp_slabs->next;
+      free (amp_slabs);
+      amp_slabs = next;
+    }
+  memset (amp_freelists, 0, sizeof (amp_freelists));
+}
+
+AmpAllocatorStats
+AmpObjectAllocatorGetStats (void)
+{
+  return amp_allocator_stats;
+}
+
+void
+AmpObjectAllocatorPrintStats (void)
+{
+  AmpAllocatorStats stats = amp_allocator_stats;
+  size_t small_allocations = stats.allocations - stats.large_allocations;
+  printf ("Object allocations: %u (%u large)\n",
+          (unsigned int) stats.allocations,
+          (unsigned int) stats.large_allocations);
+  printf ("Freelist hits: %u of %u (%.1f%%), slabs: %u\n",
+          (unsigned int) stats.freelist_hits,
+          (unsigned int) small_allocations,
+          small_allocations
+            ? 100.0 * stats.freelist_hits / small_allocations
+            : 0.0,
+          (unsigned int) stats.slabs);
 }
 
 void
 AmpObjectIncrementRefcount (AmpObject *obj)
 {
+  if (AMP_OBJECT_IS_IMMORTAL (obj))
+    return;
   obj->refcount++;
 }
 void
 AmpObjectDecrementRefcount (AmpObject *obj)
 {
+  if (AMP_OBJECT_IS_IMMORTAL (obj))
+    return;
   obj->refcount--;
   if (obj->refcount == 0)
     {
@@ -40,22 +166,46 @@ AmpObjectDecrementRefcount (AmpObject *obj)
     }
 }
 
-AmpObject *AmpObjectUnsupportedOperation (AmpObject *this, AmpObject *var)
+void
+AmpObjectMakeImmortal (AmpObject *obj)
 {
-  printf (ample_error_codes[ERROR_UNSUPPORTED_OPERATION],
-          AMP_OBJECT_TYPE_STR[this->info->type],
-          AMP_OBJECT_TYPE_STR[var->info->type]);
-  exit (EXIT_FAILURE);
+  obj->refcount = AMP_OBJECT_IMMORTAL_REFCOUNT;
 }
 
-void AmpObjectInitializeOperationsToUnsupported (AmpOperations *ops)
+void
+AmpObjectDestroyImmortal (AmpObject *obj)
 {
-  ops->add = AmpObjectUnsupportedOperation;
-  ops->sub = AmpObjectUnsupportedOperation;
-  ops->div = AmpObjectUnsupportedOperation;
-  ops->mult = AmpObjectUnsupportedOperation;
-  ops->equal = AmpObjectUnsupportedOperation;
-  ops->not_equal = AmpObjectUnsupportedOperation;
-  ops->less_than = AmpObjectUnsupportedOperation;
-  ops->greater_than = AmpObjectUnsupportedOperation;
+  obj->dealloc (obj);
+}
+
+void
+AmpValueIncrementRefcount (AmpValue v)
+{
+  if (AMP_VALUE_IS_OBJECT (v))
+    AmpObjectIncrementRefcount (AMP_VALUE_TO_OBJECT (v));
+}
+
+void
+AmpValueDecrementRefcount (AmpValue v)
+{
+  if (AMP_VALUE_IS_OBJECT (v))
+    AmpObjectDecrementRefcount (AMP_VALUE_TO_OBJECT (v));
+}
+
+AmpObjectInfo *
+AmpValueInfo (AmpValue v)
+{
+  if (AMP_VALUE_IS_NUMBER (v))
+    return &amp_number_info;
+  if (AMP_VALUE_IS_OBJECT (v))
+    return AMP_VALUE_TO_OBJECT (v)->info;
+  return &amp_bool_info;
+}
+
+AmpValue AmpObjectUnsupportedOperation (AmpValue this, AmpValue var)
+{
+  printf (ample_error_codes[ERROR_UNSUPPORTED_OPERATION],
+          AMP_OBJECT_TYPE_STR[AMP_VALUE_TYPE (this)],
+          AMP_OBJECT_TYPE_STR[AMP_VALUE_TYPE (var)]);
+  exit (EXIT_FAILURE);
 }
@@ -16,6 +16,7 @@
 */
 #ifndef AMP_OBJECT_H_
 #define AMP_OBJECT_H_
+#include <stdint.h>
 
 #define X(type) type,
 #define AMP_OBJECT_TYPES \
@@ -36,15 +37,65 @@ const char *AMP_OBJECT_TYPE_STR[] = {
 struct AmpObject;
 typedef struct AmpObject AmpObject;
 
+/* Every value is 64 bits wide. Numbers are stored as plain doubles,
+ * everything else hides in the payload of a quiet NaN:
+ *   bools and the empty value : QNAN | tag
+ *   heap objects              : SIGN | QNAN | pointer
+ * so only strings and lists are allocated. The empty value is held by
+ * variables and registers that haven't been assigned, and is returned
+ * by expressions that don't produce anything */
+typedef uint64_t AmpValue;
+#define AMP_VALUE_SIGN_BIT ((uint64_t) 0x8000000000000000)
+#define AMP_VALUE_QNAN ((uint64_t) 0x7FFC000000000000)
+#define AMP_VALUE_TAG_EMPTY 1
+#define AMP_VALUE_TAG_FALSE 2
+#define AMP_VALUE_TAG_TRUE 3
+#define AMP_VALUE_EMPTY ((AmpValue) (AMP_VALUE_QNAN | AMP_VALUE_TAG_EMPTY))
+#define AMP_VALUE_FALSE ((AmpValue) (AMP_VALUE_QNAN | AMP_VALUE_TAG_FALSE))
+#define AMP_VALUE_TRUE ((AmpValue) (AMP_VALUE_QNAN | AMP_VALUE_TAG_TRUE))
+
+#define AMP_VALUE_IS_EMPTY(v) ((v) == AMP_VALUE_EMPTY)
+#define AMP_VALUE_IS_NUMBER(v) (((v) & AMP_VALUE_QNAN) != AMP_VALUE_QNAN)
+#define AMP_VALUE_IS_BOOL(v) (((v) | 1) == AMP_VALUE_TRUE)
+#define AMP_VALUE_IS_OBJECT(v)                                                 \
+  (((v) & (AMP_VALUE_SIGN_BIT | AMP_VALUE_QNAN))                               \
+   == (AMP_VALUE_SIGN_BIT | AMP_VALUE_QNAN))
+
+#define AMP_VALUE_TO_BOOL(v) ((v) == AMP_VALUE_TRUE)
+#define AMP_VALUE_FROM_BOOL(b) ((b) ? AMP_VALUE_TRUE : AMP_VALUE_FALSE)
+#define AMP_VALUE_TO_OBJECT(v)                                                 \
+  ((AmpObject *) (uintptr_t) ((v) & ~(AMP_VALUE_SIGN_BIT | AMP_VALUE_QNAN)))
+#define AMP_VALUE_FROM_OBJECT(obj)                                             \
+  ((AmpValue) (AMP_VALUE_SIGN_BIT | AMP_VALUE_QNAN | (uintptr_t) (obj)))
+
+static inline double
+AMP_VALUE_TO_NUMBER (AmpValue v)
+{
+  union { AmpValue v; double d; } u;
+  u.v = v;
+  return u.d;
+}
+
+static inline AmpValue
+AMP_VALUE_FROM_NUMBER (double d)
+{
+  union { AmpValue v; double d; } u;
+  /* a NaN could look like a tagged value, only keep the canonical one */
+  if (d != d)
+    return (AmpValue) 0x7FF8000000000000;
+  u.d = d;
+  return u.v;
+}
+
 typedef struct AmpOperations {
-  AmpObject *(*add)(AmpObject *, AmpObject *);
-  AmpObject *(*sub)(AmpObject *, AmpObject *);
-  AmpObject *(*div)(AmpObject *, AmpObject *);
-  AmpObject *(*mult)(AmpObject *, AmpObject *);
-  AmpObject *(*equal)(AmpObject *, AmpObject *);
-  AmpObject *(*not_equal)(AmpObject *, AmpObject *);
-  AmpObject *(*less_than)(AmpObject *, AmpObject *);
-  AmpObject *(*greater_than)(AmpObject *, AmpObject *);
+  AmpValue (*add)(AmpValue, AmpValue);
+  AmpValue (*sub)(AmpValue, AmpValue);
+  AmpValue (*div)(AmpValue, AmpValue);
+  AmpValue (*mult)(AmpValue, AmpValue);
+  AmpValue (*equal)(AmpValue, AmpValue);
+  AmpValue (*not_equal)(AmpValue, AmpValue);
+  AmpValue (*less_than)(AmpValue, AmpValue);
+  AmpValue (*greater_than)(AmpValue, AmpValue);
 } AmpOperations;
 typedef struct AmpObjectInfo {
   AmpObjectType type;
@@ -52,6 +103,7 @@ typedef struct AmpObjectInfo {
 } AmpObjectInfo;
 #define AMP_OBJECT_HEADER                                                      \
   unsigned int refcount;                                                       \
+  unsigned int size_class; /* set by AmpObjectAllocate */                      \
   AmpObjectInfo *info;                                                         \
   void (*dealloc)(AmpObject *)
 
@@ -59,10 +111,52 @@ struct AmpObject {
   AMP_OBJECT_HEADER;
 };
 #define AMP_OBJECT(obj) ((AmpObject *)(obj))
+/* an immortal object ignores refcounting, whoever made it
+ * immortal frees it with AmpObjectDestroyImmortal */
+#define AMP_OBJECT_IMMORTAL_REFCOUNT ((unsigned int) -1)
+#define AMP_OBJECT_IS_IMMORTAL(obj)                                            \
+  ((obj)->refcount == AMP_OBJECT_IMMORTAL_REFCOUNT)
 void AmpObjectIncrementRefcount(AmpObject *obj);
 void AmpObjectDecrementRefcount(AmpObject *obj);
+/* returns the object to the allocator, it has to
+ * come from AmpObjectAllocate */
 void AmpObjectDestroyBasic(AmpObject *obj);
+void AmpObjectMakeImmortal(AmpObject *obj);
+void AmpObjectDestroyImmortal(AmpObject *obj);
+
+/* Objects are allocated from slabs. Every size class, a multiple of
+ * AMP_ALLOCATOR_GRANULE up to AMP_ALLOCATOR_MAX_SIZE, keeps a freelist
+ * of the objects that died so they can be reused without calling
+ * malloc. Bigger objects, long strings mostly, go straight to malloc */
+#define AMP_ALLOCATOR_GRANULE 16
+#define AMP_ALLOCATOR_CLASS_COUNT 16
+#define AMP_ALLOCATOR_MAX_SIZE                                                 \
+  (AMP_ALLOCATOR_GRANULE * AMP_ALLOCATOR_CLASS_COUNT)
+#define AMP_ALLOCATOR_LARGE AMP_ALLOCATOR_CLASS_COUNT
+#define AMP_ALLOCATOR_SLAB_SIZE 4096
+typedef struct AmpAllocatorStats {
+  size_t allocations;
+  size_t freelist_hits;     /* allocations that reused a dead object */
+  size_t slabs;
+  size_t large_allocations;
+} AmpAllocatorStats;
+/* size includes the object header, only the size class is initialized */
+AmpObject *AmpObjectAllocate(size_t size);
+/* makes the object at least size bytes big, keeping its contents.
+ * It stays where it is if its size class has room, otherwise it moves,
+ * so only the holder of its one reference may resize it */
+AmpObject *AmpObjectResize(AmpObject *obj, size_t size);
+/* frees every slab, no object may be alive anymore */
+void AmpObjectAllocatorRelease(void);
+AmpAllocatorStats AmpObjectAllocatorGetStats(void);
+void AmpObjectAllocatorPrintStats(void);
+
+/* the refcount functions do nothing for values that aren't objects */
+void AmpValueIncrementRefcount(AmpValue v);
+void AmpValueDecrementRefcount(AmpValue v);
+/* the type info of any value, numbers and bools share a static one */
+AmpObjectInfo *AmpValueInfo(AmpValue v);
+#define AMP_VALUE_TYPE(v) (AmpValueInfo (v)->type)
 
-AmpObject *AmpObjectUnsupportedOperation(AmpObject *, AmpObject *);
-void AmpObjectInitializeOperationsToUnsupported (AmpOperations *ops);
+AmpValue AmpObjectUnsupportedOperation(AmpValue, AmpValue);
 #endif
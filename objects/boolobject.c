@@ -16,23 +16,18 @@
 */
 #include "boolobject.h"
 #include <stdlib.h>
-static AmpObjectInfo bool_info;
-static bool32 bool_info_initialized;
-AmpObject *
-AmpBoolCreate (bool32 val)
-{
-  AmpObject_Bool *obj = NULL;
-  if (!bool_info_initialized)
-    {
-      bool_info.type = AMP_OBJECT_BOOL;
-      AmpObjectInitializeOperationsToUnsupported (&bool_info.ops);
-    }
-  obj = malloc (sizeof (AmpObject_Bool));
-  obj->info = &bool_info;
-  obj->refcount = 1;
-  obj->dealloc = AmpObjectDestroyBasic;
-  obj->val = val;
-
-  return AMP_OBJECT (obj);
-}
-
+/* bools support no operations, the comparisons only work on
+ * numbers and strings */
+AmpObjectInfo amp_bool_info = {
+  AMP_OBJECT_BOOL,
+  {
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+  },
+};
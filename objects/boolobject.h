@@ -18,10 +18,7 @@
 #define BOOL_OBJECT_H_
 #include "ampobject.h"
 #include "../bool.h"
-typedef struct AmpObject_Bool {
-  AMP_OBJECT_HEADER;
-  bool32 val;
-} AmpObject_Bool;
-#define AMP_BOOL(obj) ((AmpObject_Bool *)(obj))
-AmpObject *AmpBoolCreate (bool32 val);
+/* bools are never allocated, see AmpValue */
+extern AmpObjectInfo amp_bool_info;
+#define AmpBoolCreate(val) AMP_VALUE_FROM_BOOL (val)
 #endif
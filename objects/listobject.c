@@ -22,33 +22,39 @@
 void
 amp_list_dealloc(AmpObject *obj)
 {
-  AmpObject_List *list = AMP_LIST (obj);
+  AmpObject_List *list = (AmpObject_List *) obj;
   for (size_t i = 0; i < ARRAY_COUNT (list->array); i++)
     {
-      AmpObjectDecrementRefcount (list->array[i]);
+      AmpValueDecrementRefcount (list->array[i]);
     }
-  ARRAY_FREE (AMP_LIST (obj)->array);
+  ARRAY_FREE (list->array);
   AmpObjectDestroyBasic (obj);
 }
 
-static AmpObjectInfo list_info;
-static bool32 list_info_initialized;
-AmpObject *
-AmpListCreate (AmpObject **array)
+static AmpObjectInfo list_info = {
+  AMP_OBJECT_LIST,
+  {
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+  },
+};
+
+AmpValue
+AmpListCreate (AmpValue *array)
 {
   AmpObject_List *list = NULL;
-  if (!list_info_initialized)
-    {
-      list_info.type = AMP_OBJECT_LIST;
-      AmpObjectInitializeOperationsToUnsupported (&list_info.ops);
-
-      list_info_initialized = true;
-    }
-  list = calloc (1, sizeof(AmpObject_List));
+  list = (AmpObject_List *) AmpObjectAllocate (sizeof (AmpObject_List));
+  list->array = NULL;
   list->info = &list_info;
   list->dealloc = amp_list_dealloc;
   list->refcount = 1;
   if (array)
     list->array = array;
-  return AMP_OBJECT (list);
+  return AMP_VALUE_FROM_OBJECT (list);
 }
@@ -19,8 +19,9 @@
 #include "ampobject.h"
 typedef struct AmpObject_List {
   AMP_OBJECT_HEADER;
-  AmpObject **array;
+  AmpValue *array;
 } AmpObject_List;
-#define AMP_LIST(obj) ((AmpObject_List *)(obj))
-AmpObject *AmpListCreate(AmpObject **array);
+/* v has to hold a list object */
+#define AMP_LIST(v) ((AmpObject_List *) AMP_VALUE_TO_OBJECT (v))
+AmpValue AmpListCreate(AmpValue *array);
 #endif
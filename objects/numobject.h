@@ -17,18 +17,22 @@
 #ifndef INT_OBJECT_H_
 #define INT_OBJECT_H_
 #include "ampobject.h"
+#include <math.h>
+#include <float.h>
 
-typedef struct AmpObject_Num {
-  AMP_OBJECT_HEADER;
-  double val;
-} AmpObject_Num;
-#define AMP_NUMBER(obj) ((AmpObject_Num *)(obj))
-AmpObject *AmpNumberCreate(double val);
+/* numbers are never allocated, see AmpValue */
+extern AmpObjectInfo amp_number_info;
+#define AmpNumberCreate(val) AMP_VALUE_FROM_NUMBER (val)
+/* the engines compare numbers without going through amp_number_info,
+ * so equality is only defined here */
+#define AMP_NUMBER_EQUAL(a, b) (fabs ((a) - (b)) < DBL_EPSILON)
 
-AmpObject *amp_number_add(AmpObject *this, AmpObject *val);
-AmpObject *amp_number_sub(AmpObject *this, AmpObject *val);
-AmpObject *amp_number_div(AmpObject *this, AmpObject *val);
-AmpObject *amp_number_mul(AmpObject *this, AmpObject *val);
-AmpObject *amp_number_equal(AmpObject *this, AmpObject *val);
-AmpObject *amp_integer_not_equal (AmpObject *this, AmpObject *val);
+AmpValue amp_integer_add(AmpValue this, AmpValue val);
+AmpValue amp_integer_sub(AmpValue this, AmpValue val);
+AmpValue amp_integer_div(AmpValue this, AmpValue val);
+AmpValue amp_integer_mul(AmpValue this, AmpValue val);
+AmpValue amp_integer_equal(AmpValue this, AmpValue val);
+AmpValue amp_integer_not_equal (AmpValue this, AmpValue val);
+AmpValue amp_integer_less_than (AmpValue this, AmpValue other);
+AmpValue amp_integer_greater_than (AmpValue this, AmpValue other);
 #endif
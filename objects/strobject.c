@@ -16,65 +16,105 @@
 */
 #include "strobject.h"
 #include "boolobject.h"
+#include "../hash.h"
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
-AmpObject *
-amp_string_concat (AmpObject *this, AmpObject *str)
+AmpValue
+amp_string_concat (AmpValue this, AmpValue str)
 {
-  size_t size = strlen (AMP_STRING (this)->string);
-  AmpObject* obj = NULL;
-  char *s = NULL;
+  AmpObject_Str *head = AMP_STRING (this);
+  AmpObject_Str *tail = AMP_STRING (str);
+  AmpObject_Str *a = amp_string_allocate (head->length + tail->length);
 
-  size += strlen (AMP_STRING (str)->string);
-  s = calloc (1, size+1);
-  strcat (s, AMP_STRING (this)->string);
-  strcat (s, AMP_STRING (str)->string);
-
-  obj = AmpStringCreate (s);
-  free (s);
-  return obj;
+  memcpy (a->string, head->string, head->length);
+  memcpy (a->string + head->length, tail->string, tail->length + 1);
+  return AMP_VALUE_FROM_OBJECT (a);
 }
 
-AmpObject *
-amp_string_equal (AmpObject *this, AmpObject *str)
+AmpValue
+amp_string_equal (AmpValue this, AmpValue str)
 {
-  const char *string1 = AMP_STRING (this)->string;
-  const char *string2 = AMP_STRING (str)->string;
-  bool32 equal = 0 == strcmp (string1, string2);
-  return AmpBoolCreate (equal);
+  AmpObject_Str *string1 = AMP_STRING (this);
+  AmpObject_Str *string2 = AMP_STRING (str);
+  if (string1 == string2)
+    return AmpBoolCreate (true);
+  /* strings that differ mostly differ in length or hash,
+   * so the bytes are only compared when both match */
+  if (string1->length != string2->length
+      || AmpStringHash (this) != AmpStringHash (str))
+    return AmpBoolCreate (false);
+  return AmpBoolCreate (0 == memcmp (string1->string,
+                                     string2->string,
+                                     string1->length));
 }
 
-AmpObject *
-amp_string_not_equal (AmpObject *this, AmpObject *str)
+AmpValue
+amp_string_not_equal (AmpValue this, AmpValue str)
 {
-  AmpObject_Bool *equal = AMP_BOOL (amp_string_equal (this, str));
-  equal->val = !equal->val;
-  return AMP_OBJECT (equal);
+  return AmpBoolCreate (!AMP_VALUE_TO_BOOL (amp_string_equal (this, str)));
 }
 
+static AmpObjectInfo str_info = {
+  AMP_OBJECT_STRING,
+  {
+    amp_string_concat,
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+    amp_string_equal,
+    amp_string_not_equal,
+    AmpObjectUnsupportedOperation,
+    AmpObjectUnsupportedOperation,
+  },
+};
 
-static AmpObjectInfo str_info;
-static bool32 str_info_initialized;
-AmpObject *
-AmpStringCreate (const char *str)
+AmpObject_Str *
+amp_string_allocate (size_t length)
 {
   AmpObject_Str *a = NULL;
-  
-  if (!str_info_initialized)
-    {
-      str_info.type = AMP_OBJECT_STRING;
-      AmpObjectInitializeOperationsToUnsupported (&str_info.ops);
-      str_info.ops.add = amp_string_concat;
-      str_info.ops.equal = amp_string_equal;
-      str_info.ops.not_equal = amp_string_not_equal;
-      str_info_initialized = true;
-    }
 
-  a = malloc (sizeof (AmpObject_Str) - 1 + strlen (str) + 1);
+  a = (AmpObject_Str *) AmpObjectAllocate (offsetof (AmpObject_Str, string)
+                                           + length + 1);
   a->refcount = 1;
   a->info = &str_info;
   a->dealloc = AmpObjectDestroyBasic;
-  strcpy (a->string, str);
-  return AMP_OBJECT (a);
+  a->length = length;
+  a->hash = 0;
+  return a;
+}
+
+AmpValue
+AmpStringCreate (const char *str)
+{
+  size_t length = strlen (str);
+  AmpObject_Str *a = amp_string_allocate (length);
+  memcpy (a->string, str, length + 1);
+  return AMP_VALUE_FROM_OBJECT (a);
 }
 
+size_t
+AmpStringHash (AmpValue v)
+{
+  AmpObject_Str *a = AMP_STRING (v);
+  /* a string that hashes to 0 is just hashed again every time */
+  if (!a->hash)
+    a->hash = hash_bytes (a->string, a->length);
+  return a->hash;
+}
+
+AmpValue
+AmpStringAppend (AmpValue this, AmpValue str)
+{
+  AmpObject_Str *a = AMP_STRING (this);
+  AmpObject_Str *tail = AMP_STRING (str);
+  size_t length = a->length;
+
+  a = (AmpObject_Str *) AmpObjectResize (AMP_OBJECT (a),
+                                         offsetof (AmpObject_Str, string)
+                                         + length + tail->length + 1);
+  memcpy (a->string + length, tail->string, tail->length + 1);
+  a->length = length + tail->length;
+  a->hash = 0;
+  return AMP_VALUE_FROM_OBJECT (a);
+}
@@ -20,12 +20,29 @@
 typedef struct AmpObject_Str
 {
   AMP_OBJECT_HEADER;
+  size_t length; /* bytes before the terminating NUL */
+  size_t hash;   /* 0 until AmpStringHash computes it */
   char string[1];
 } AmpObject_Str;
-#define AMP_STRING(obj) ((AmpObject_Str *)(obj))
-AmpObject *AmpStringCreate (const char* str);
+/* v has to hold a string object */
+#define AMP_STRING(v) ((AmpObject_Str *) AMP_VALUE_TO_OBJECT (v))
+AmpValue AmpStringCreate (const char* str);
+/* the hash of the string's bytes, computed on first use */
+size_t AmpStringHash (AmpValue v);
+/* this has to be a string nothing else holds and str a different one.
+ * str is copied onto the end of this, in place if its allocation has
+ * room. The string can move, the returned value replaces this */
+AmpValue AmpStringAppend (AmpValue this, AmpValue str);
+/* a string held by one reference, its holder can append to it */
+#define AMP_STRING_IS_UNSHARED(v)                                              \
+  (AMP_VALUE_IS_OBJECT (v)                                                     \
+   && AMP_VALUE_TO_OBJECT (v)->info->type == AMP_OBJECT_STRING                 \
+   && AMP_VALUE_TO_OBJECT (v)->refcount == 1)
 
-AmpObject *amp_string_concat (AmpObject *this, AmpObject *str);
-AmpObject *amp_string_equal (AmpObject *this, AmpObject *str);
-AmpObject *amp_string_not_equal (AmpObject *this, AmpObject *str);
+/* a string object of length characters, the characters
+ * are left to the caller */
+AmpObject_Str *amp_string_allocate (size_t length);
+AmpValue amp_string_concat (AmpValue this, AmpValue str);
+AmpValue amp_string_equal (AmpValue this, AmpValue str);
+AmpValue amp_string_not_equal (AmpValue this, AmpValue str);
 #endif
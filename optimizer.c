@@ -0,0 +1,363 @@
+/*
+    This file is part of Ample.
+
+    Ample is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ample is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ample.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "optimizer.h"
+#include "array.h"
+#include "ast.h"
+#include "objects/ampobject.h"
+#include "objects/boolobject.h"
+#include "objects/numobject.h"
+#include "objects/strobject.h"
+#include "interpreter_functions.h"
+
+#include <string.h>
+
+void
+OptimizeProgram (ASTHandle head)
+{
+  optimizer_optimize_statements (head);
+}
+
+ASTHandle
+optimizer_fold_expression (ASTHandle handle)
+{
+  struct AST *node = ast_get_node (handle);
+  ASTHandle *left;
+  ASTHandle *right;
+  AmpValue left_value;
+  AmpValue right_value;
+  OptimizerOperation operation;
+  ASTHandle folded;
+
+  if (!node)
+    return handle;
+  switch (node->type)
+    {
+    case AST_BINARY_OP:
+      left = &node->d.bop_data.left;
+      right = &node->d.bop_data.right;
+      break;
+    case AST_BINARY_COMPARATOR:
+      left = &node->d.bcmp_data.left;
+      right = &node->d.bcmp_data.right;
+      break;
+    case AST_FUNC_CALL:
+      optimizer_fold_arguments (node->d.func_call_data.args);
+      return handle;
+    case AST_LIST:
+      optimizer_fold_arguments (node->d.list_data.items);
+      return handle;
+    default:
+      return handle;
+    }
+
+  /* nodes never move, so node stays good while folding makes new ones */
+  *left = optimizer_fold_expression (*left);
+  *right = optimizer_fold_expression (*right);
+  if (!optimizer_literal_value (ast_get_node (*left), &left_value))
+    return handle;
+  if (!optimizer_literal_value (ast_get_node (*right), &right_value))
+    {
+      AmpValueDecrementRefcount (left_value);
+      return handle;
+    }
+
+  operation = optimizer_operation (node, left_value, right_value);
+  folded = handle;
+  if (operation)
+    folded = optimizer_literal_node (operation (left_value, right_value));
+  AmpValueDecrementRefcount (left_value);
+  AmpValueDecrementRefcount (right_value);
+  return folded;
+}
+
+void
+optimizer_fold_arguments (ASTHandle *args)
+{
+  size_t i;
+  for (i = 0; i < ARRAY_COUNT (args); i++)
+    {
+      args[i] = optimizer_fold_expression (args[i]);
+    }
+}
+
+bool32
+optimizer_literal_value (struct AST *node, AmpValue *value)
+{
+  switch (node->type)
+    {
+    case AST_INTEGER:
+      *value = AmpNumberCreate (node->d.int_data.value);
+      return true;
+    case AST_STRING:
+      *value = AmpStringCreate (node->d.str_data.str);
+      return true;
+    case AST_BOOL:
+      *value = AmpBoolCreate (node->d.bool_data.value);
+      return true;
+    default:
+      return false;
+    }
+}
+
+ASTHandle
+optimizer_literal_node (AmpValue value)
+{
+  ASTHandle handle = 0;
+  struct AST *node;
+  switch (AMP_VALUE_TYPE (value))
+    {
+    case AMP_OBJECT_NUMBER:
+      handle = ast_new_node (AST_INTEGER);
+      node = ast_get_node (handle);
+      node->d.int_data.value = AMP_VALUE_TO_NUMBER (value);
+      break;
+    case AMP_OBJECT_BOOL:
+      handle = ast_new_node (AST_BOOL);
+      node = ast_get_node (handle);
+      node->d.bool_data.value = AMP_VALUE_TO_BOOL (value);
+      break;
+    case AMP_OBJECT_STRING:
+      {
+        AmpObject_Str *str = AMP_STRING (value);
+        handle = ast_new_node (AST_STRING);
+        node = ast_get_node (handle);
+        node->d.str_data.str = ast_copy_string (str->string, str->length);
+      }
+      break;
+    default:
+      break;
+    }
+  AmpValueDecrementRefcount (value);
+  return handle;
+}
+
+OptimizerOperation
+optimizer_operation (struct AST *node, AmpValue left, AmpValue right)
+{
+  AmpOperations *ops = &AmpValueInfo (left)->ops;
+  OptimizerOperation operation = NULL;
+  /* these are errors when the program runs */
+  if (AMP_VALUE_TYPE (left) != AMP_VALUE_TYPE (right))
+    return NULL;
+  if (node->type == AST_BINARY_OP)
+    {
+      switch (node->d.bop_data.op)
+        {
+        case '+': operation = ops->add; break;
+        case '-': operation = ops->sub; break;
+        case '*': operation = ops->mult; break;
+        case '/': operation = ops->div; break;
+        default: break;
+        }
+    }
+  else
+    {
+      switch (node->d.bcmp_data.type)
+        {
+        case BOP_EQUAL: operation = ops->equal; break;
+        case BOP_NOT_EQUAL: operation = ops->not_equal; break;
+        case BOP_LESS_THAN: operation = ops->less_than; break;
+        case BOP_GREATER_THAN: operation = ops->greater_than; break;
+        }
+    }
+  if (operation == AmpObjectUnsupportedOperation)
+    return NULL;
+  return operation;
+}
+
+void
+optimizer_optimize_statements (ASTHandle scope_handle)
+{
+  struct AST *scope = ast_get_node (scope_handle);
+  ASTHandle *statements = NULL;
+  size_t i;
+  if (!scope)
+    return;
+  for (i = 0; i < ARRAY_COUNT (scope->d.scope_data.statements); i++)
+    {
+      optimizer_optimize_statement (scope->d.scope_data.statements[i],
+                                    &statements);
+    }
+  ARRAY_FREE (scope->d.scope_data.statements);
+  scope->d.scope_data.statements = statements;
+}
+
+void
+optimizer_optimize_statement (ASTHandle handle, ASTHandle **statements)
+{
+  struct AST *node = ast_get_node (handle);
+  switch (node->type)
+    {
+    case AST_INTEGER:
+    case AST_STRING:
+    case AST_BOOL:
+    case AST_IDENTIFIER:
+      /* evaluating these has no effect */
+      return;
+    case AST_ASSIGNMENT:
+      node->d.asgn_data.expr =
+        optimizer_fold_expression (node->d.asgn_data.expr);
+      break;
+    case AST_IF:
+      {
+        struct IfAST *if_data = &node->d.if_data;
+        struct AST *expr;
+        struct AST *taken;
+        size_t i;
+        if_data->expr = optimizer_fold_expression (if_data->expr);
+        optimizer_optimize_statements (if_data->scope_if_true);
+        optimizer_optimize_statements (if_data->scope_if_false);
+        expr = ast_get_node (if_data->expr);
+        if (expr->type != AST_BOOL)
+          break;
+
+        if (!expr->d.bool_data.value)
+          {
+            if_data->scope_if_true = if_data->scope_if_false;
+            if_data->expr = optimizer_literal_node (AmpBoolCreate (true));
+          }
+        if_data->scope_if_false = 0;
+        taken = ast_get_node (if_data->scope_if_true);
+        if (!taken)
+          return;
+        if (taken->d.scope_data.has_frame)
+          {
+            /* the branch keeps its own variables, so it stays
+             * a block behind a test that always passes */
+            break;
+          }
+        /* a block without a frame already uses the frame around it */
+        for (i = 0; i < ARRAY_COUNT (taken->d.scope_data.statements); i++)
+          {
+            ARRAY_PUSH ((*statements), taken->d.scope_data.statements[i]);
+          }
+        return;
+      }
+    case AST_WHILE:
+      {
+        struct AST *expr;
+        node->d.while_data.expr =
+          optimizer_fold_expression (node->d.while_data.expr);
+        optimizer_optimize_statements (node->d.while_data.scope);
+        expr = ast_get_node (node->d.while_data.expr);
+        /* a loop that never runs */
+        if (expr->type == AST_BOOL && !expr->d.bool_data.value)
+          return;
+      }
+      break;
+    case AST_FOR:
+      {
+        struct ForAST *for_data = &node->d.for_data;
+        struct AST *expr;
+        for_data->init = optimizer_optimize_single_statement (for_data->init);
+        for_data->expr = optimizer_fold_expression (for_data->expr);
+        for_data->step = optimizer_optimize_single_statement (for_data->step);
+        optimizer_optimize_statements (for_data->scope);
+        expr = ast_get_node (for_data->expr);
+        if (expr->type == AST_BOOL && !expr->d.bool_data.value)
+          {
+            /* only the initializer runs */
+            if (for_data->init)
+              {
+                ARRAY_PUSH ((*statements), for_data->init);
+              }
+            return;
+          }
+      }
+      break;
+    case AST_FUNC:
+      optimizer_optimize_statements (node->d.func_data.scope);
+      optimizer_mark_tail_calls (node->d.func_data.scope, true);
+      break;
+    case AST_FUNC_CALL:
+      optimizer_fold_arguments (node->d.func_call_data.args);
+      break;
+    case AST_LIST:
+      optimizer_fold_arguments (node->d.list_data.items);
+      break;
+    case AST_BINARY_OP:
+    case AST_BINARY_COMPARATOR:
+      handle = optimizer_fold_expression (handle);
+      /* a folded one can't fail anymore */
+      if (ast_get_node (handle)->type != node->type)
+        return;
+      break;
+    default:
+      break;
+    }
+  ARRAY_PUSH ((*statements), handle);
+}
+
+ASTHandle
+optimizer_optimize_single_statement (ASTHandle handle)
+{
+  ASTHandle *statements = NULL;
+  ASTHandle result = 0;
+  if (!handle)
+    return 0;
+  optimizer_optimize_statement (handle, &statements);
+  if (ARRAY_COUNT (statements) == 1)
+    result = statements[0];
+  ARRAY_FREE (statements);
+  return result;
+}
+
+void
+optimizer_mark_tail_calls (ASTHandle scope_handle, bool32 ends_function)
+{
+  struct AST *scope = ast_get_node (scope_handle);
+  size_t count;
+  size_t i;
+  if (!scope)
+    return;
+  count = ARRAY_COUNT (scope->d.scope_data.statements);
+  for (i = 0; i < count; i++)
+    {
+      struct AST *node = ast_get_node (scope->d.scope_data.statements[i]);
+      bool32 last = ends_function && i == count - 1;
+      if (node->type == AST_IF)
+        {
+          optimizer_mark_tail_calls (node->d.if_data.scope_if_true, last);
+          optimizer_mark_tail_calls (node->d.if_data.scope_if_false, last);
+        }
+      else if (node->type == AST_WHILE || node->type == AST_FOR)
+        {
+          /* only the returns in a loop body can be tail calls */
+          optimizer_mark_tail_calls (node->type == AST_WHILE
+                                       ? node->d.while_data.scope
+                                       : node->d.for_data.scope,
+                                     false);
+        }
+      else if (node->type != AST_FUNC_CALL)
+        {
+          continue;
+        }
+      else if (node->d.func_call_data.builtin == AMPLE_BUILTIN_RETURN)
+        {
+          /* a return ends the function wherever it is */
+          ASTHandle *args = node->d.func_call_data.args;
+          struct AST *value = ARRAY_COUNT (args) == 1
+                                ? ast_get_node (args[0]) : NULL;
+          if (value && value->type == AST_FUNC_CALL)
+            value->d.func_call_data.tail = CALL_TAIL_RETURN;
+        }
+      else if (last)
+        {
+          node->d.func_call_data.tail = CALL_TAIL_STATEMENT;
+        }
+    }
+}
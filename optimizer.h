@@ -0,0 +1,63 @@
+/*
+    This file is part of Ample.
+
+    Ample is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ample is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ample.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef OPTIMIZER_H_
+#define OPTIMIZER_H_
+#include "ast.h"
+#include "bool.h"
+#include "objects/ampobject.h"
+/* ******************
+   External functions
+   ****************** */
+/* Simplifies a resolved tree before it's run:
+ *  - operators on literals are folded into a literal, as long as the
+ *    operation can't fail, failing ones are left to fail when run
+ *  - ifs on a literal bool keep only the branch that runs, loops on
+ *    a literal false are dropped
+ *  - literals and lone variables used as statements are dropped
+ *  - calls that are the last thing a function does are marked, so
+ *    they can reuse the caller's frame
+ * Both the tree walker and the compiler run the simplified tree */
+void OptimizeProgram(ASTHandle head);
+
+/* ******************
+   Internal Functions
+   ****************** */
+typedef AmpValue (*OptimizerOperation)(AmpValue left, AmpValue right);
+/* returns the handle that replaces the expression,
+ * which is the handle itself if nothing could be folded */
+ASTHandle optimizer_fold_expression(ASTHandle handle);
+void optimizer_fold_arguments(ASTHandle *args);
+/* the value of a literal node, false if the node isn't one */
+bool32 optimizer_literal_value(struct AST *node, AmpValue *value);
+/* takes over the reference to value */
+ASTHandle optimizer_literal_node(AmpValue value);
+/* the operation of a binary operator or comparison node, NULL if
+ * running it on left and right would fail */
+OptimizerOperation optimizer_operation(struct AST *node,
+                                       AmpValue left,
+                                       AmpValue right);
+/* simplifies each statement of the scope and its nested scopes */
+void optimizer_optimize_statements(ASTHandle scope_handle);
+/* appends what a statement turns into to statements */
+void optimizer_optimize_statement(ASTHandle handle, ASTHandle **statements);
+/* what a statement that has to stay a single one turns into,
+ * 0 if it's dropped */
+ASTHandle optimizer_optimize_single_statement(ASTHandle handle);
+/* marks the calls of a function body that are in tail position,
+ * ends_function is set if nothing runs after the scope */
+void optimizer_mark_tail_calls(ASTHandle scope_handle, bool32 ends_function);
+#endif
@@ -17,873 +17,525 @@
 #include "parser.h"
 #include "array.h"
 #include "ast.h"
+#include "interpreter_functions.h"
 #include "lexer.h"
-#include "queue.h"
+#include "resolver.h"
 
-unsigned int
-statement_size (struct Statement s)
-{
-  return s.end - s.start + 1;
-}
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-unsigned int global_statement_index;
 ASTHandle
-ParseTokens (struct Token *tokens)
+ParseTokens (const char *source, const struct TokenStream *tokens)
 {
-  ASTHandle head = ast_get_node_handle ();
+  ASTHandle head = ast_new_node (AST_SCOPE);
   ASTHandle *statements = NULL;
   struct AST *h;
+  struct Parser p;
+  p.source = source;
+  p.tokens = tokens;
+  p.index = 0;
+  p.count = tokens->count;
 
-  while (global_statement_index < ARRAY_COUNT (tokens) - 1)
+  while (p.index < p.count)
     {
-      struct Statement s = get_statement (tokens, &global_statement_index);
-      ARRAY_PUSH (statements, parse_statement (tokens, s));
+      ASTHandle statement = parse_statement (&p);
+      if (statement)
+        {
+          ARRAY_PUSH (statements, statement);
+        }
     }
 
   h = ast_get_node (head);
-  h->type = AST_SCOPE;
   h->d.scope_data.statements = statements;
+  ResolveProgram (head);
   return head;
 }
 
-struct Statement
-get_statement (struct Token *__restrict tokens,
-                      unsigned int *__restrict index)
+TValue
+parser_peek (struct Parser *p, unsigned int ahead)
 {
-  unsigned int i = *index;
-  struct Statement s = { 0 };
-
-  unsigned int scoped = 0;
-  while (i < ARRAY_COUNT (tokens))
-    {
-      if (tokens[i].value == '{')
-        scoped++;
-      if (tokens[i].value == '}')
-        scoped--;
-      if ((tokens[i].value == STATEMENT_DELIM || tokens[i].value == '}') && 
-           scoped == 0)
-        break;
-      i++;
-    }
-
-  /* fill in statement info */
-  s.start = *index;
-  s.end = i; /* don't care about the DELIM so the end if offset by 1 */
-
-  *index = i + 1; /* offset by one to skip past the DELIM */
-
-  #ifdef PARSER_DEBUG
-  printf ("DEGUG Statement: \n");
-  debug_print_statement (tokens, s);
-  #endif
-  return s;
+  if (p->index + ahead >= p->count)
+    return 0;
+  return p->tokens->kinds[p->index + ahead];
 }
 
-ASTHandle
-parse_statement (struct Token *t_arr, struct Statement s)
+unsigned int
+parser_advance (struct Parser *p)
 {
-  /* the "biggest" kinds of statements should go first
-   * that way we pick the biggest statement (like an if statement)
-   * and then progressively parse smaller and smaller blocks */
-  ASTHandle node = 0;
-  node = parse_possible_if_statement (t_arr, s);
-  if (node)
-    return node;
-  node = parse_possible_function (t_arr, s);
-  if (node)
-    return node;
-
-  node = parse_possible_function_call (t_arr, s);
-  if (node)
-    return node;
-
-  node = parse_possible_equality (t_arr, s);
-  if (node)
-    return node;
-
-  node = parse_possible_assignment (t_arr, s);
-  if (node)
-    return node;
-
-  node = parse_possible_list (t_arr, s);
-  if (node)
-    return node;
-
-  node = parse_possible_integer (t_arr, s);
-  if (node)
-    return node;
-
-  node = parse_possible_identifier (t_arr, s);
-  if (node)
-    return node;
-
-  node = parse_possible_arithmetic (t_arr, s);
-  if (node)
-    return node;
-
-  node = parse_possible_string (t_arr, s);
-  if (node)
-    return node;
-
-  node = parse_possible_bool (t_arr, s);
-  if (node)
-    return node;
-
-  if (is_arithmetic_op (t_arr[s.start].value))
-    {
-      node = ast_get_node_handle ();
-      struct AST *ast = ast_get_node (node);
-      ast->d.op_data.op = t_arr[s.start].value;
-      ast->type = AST_OP;
-      return node;
-    }
-
-
-  printf ("Invalid statement: \n");
-  debug_print_statement (t_arr, s);
-  exit (1);
+  unsigned int token = p->index;
+  if (p->index < p->count)
+    p->index++;
+  return token;
 }
 
-ASTHandle
-parse_possible_list(struct Token *t_arr, struct Statement s)
+bool32
+parser_match (struct Parser *p, TValue v)
 {
-  /* [ ... ]
-   * [ A, B, C]
-   * [] */
-  if (statement_size (s) >= 2 &&
-      t_arr[s.start].value == '[')
-    {
-      unsigned int end_index;
-      return parse_list (t_arr, s, &end_index);
-    }
-
-  return 0;
+  if (parser_peek (p, 0) != v)
+    return false;
+  p->index++;
+  return true;
 }
 
-ASTHandle
-parse_list (struct Token *restrict t_arr,
-            struct Statement s,
-            unsigned int *restrict end_index)
+unsigned int
+parser_expect (struct Parser *p, TValue v, const char *what)
 {
-  ASTHandle node = 0;
-  struct AST *n = NULL;
-  ASTHandle *items = NULL;
-  unsigned int end = s.start + 1; /* skip '[' */
-  while (1)
+  if (parser_peek (p, 0) != v)
     {
-      /* parse a comma separated argument */
-      unsigned int start = end;
-      while (t_arr[end].value != ',' && t_arr[end].value != ']')
-        {
-          if (t_arr[end].value == '[') /* inner list */
-            {
-              struct Statement inner_list = { end, s.end };
-              ARRAY_PUSH (items, parse_list (t_arr, inner_list, &end));
-              start = ++end;
-              continue;
-            }
-          end++;
-        }
-      if (end-start >= 1)
-        {
-          struct Statement item_statement;
-          item_statement.start = start;
-          item_statement.end = end-1; /* ignore ',' */
-          ARRAY_PUSH (items, parse_statement (t_arr, item_statement));
-        }
-      if (t_arr[end].value == ']')
-        {
-          *end_index = end;
-          break;
-        }
-      else
-        {
-          ++end; /* skip over ',' */
-        }
+      char message[64];
+      snprintf (message, sizeof (message), "expected %s", what);
+      parser_error (p, message);
     }
-  node = ast_get_node_handle ();
-  n = ast_get_node (node);
-  n->type = AST_LIST;
-  n->d.list_data.items = items;
-
-  return node;
+  return parser_advance (p);
 }
 
-ASTHandle
-parse_possible_function_call(struct Token *t_arr, struct Statement s)
+void
+parser_error (struct Parser *p, const char *message)
 {
-  ASTHandle node = 0;
-  /* lowerst possible size is 3
-   * i.e. "func()" is an identifier and
-   * the two paren tokens */
-  if (statement_size (s) >= 3)
-    {
-      if (t_arr[s.start].value == TOK_IDENTIFIER &&
-          t_arr[s.start + 1].value == '(')
-        {
-          struct AST *func_call;
-          ASTHandle *args =
-            parse_arguments_surrounded_by_parens (t_arr, s.start + 1);
-
-          node = ast_get_node_handle ();
-          func_call = ast_get_node (node);
-          func_call->type = AST_FUNC_CALL;
-          func_call->d.func_call_data.name = t_arr[s.start].string;
-          func_call->d.func_call_data.args = args;
-        }
-    }
-  return node;
+  printf ("Invalid statement: %s, found ", message);
+  debug_print_token (p->source, p->tokens, p->index);
+  printf ("\n");
+  exit (1);
 }
 
-ASTHandle *
-parse_arguments (struct Token *t_arr, struct Statement s)
+char *
+parser_token_string (struct Parser *p, unsigned int token)
 {
-  unsigned int i;
-  unsigned int start_statement = s.start;
-  const char argument_separator = ',';
-  ASTHandle *parsed_arguments = NULL;
-
-  i = s.start;
-  bool32 another_argument = true;
-  while (i <= s.end)
-    {
-      if (t_arr[i].value == '[')
-        {
-          struct Statement list_statement = { i, s.end };
-          ARRAY_PUSH (parsed_arguments,
-                      parse_list (t_arr, list_statement, &i));
-          another_argument = false;
-        }
-      else if (t_arr[i].value == argument_separator)
-        {
-          struct Statement statement;
-          statement.start = start_statement;
-          statement.end = i - 1;
-          ARRAY_PUSH (parsed_arguments, parse_statement (t_arr, statement));
-
-          /* skip the argument separator */
-          start_statement = i + 1;
-          another_argument = true;
-        }
-      ++i;
-    }
-  if (another_argument)
-    {
-      struct Statement statement;
-      statement.start = start_statement;
-      statement.end = i-1;
-      ARRAY_PUSH (parsed_arguments, parse_statement (t_arr, statement));
-    }
-  return parsed_arguments;
+  return ast_copy_string (p->source + p->tokens->starts[token],
+                          TokenLength (p->tokens, token));
 }
 
-ASTHandle *
-parse_arguments_surrounded_by_parens (struct Token *t_arr,
-                                      unsigned int start_index)
+Symbol
+parser_token_symbol (struct Parser *p, unsigned int token)
 {
-  /* if there are no args return null */
-  if (t_arr[start_index].value == '(' &&
-      t_arr[start_index + 1].value == ')')
-    {
-      return NULL;
-    }
-  /* if we have args inside parens */
-  else if (t_arr[start_index].value == '(')
-    {
-      struct Statement s;
-      unsigned int end_index = start_index + 1;
-      size_t arr_length = ARRAY_COUNT (t_arr);
-      s.start = start_index + 1;
-
-      while (end_index < arr_length && t_arr[end_index].value != ')')
-        {
-          end_index++;
-        }
-      s.end = end_index - 1;
-      return parse_arguments (t_arr, s);
-    }
-  else
-    {
-      printf ("Unable to parse arguments...\n");
-      exit (1);
-    }
+  return SymbolIntern (p->source + p->tokens->starts[token],
+                       TokenLength (p->tokens, token));
 }
 
-ASTHandle
-parse_possible_function(struct Token *t_arr, struct Statement s)
+bool32
+parser_peek_operator (struct Parser *p, struct ParserOperator *op)
 {
-  ASTHandle node = 0;
-  if (statement_size (s) > 1 && t_arr[s.start].value == TOK_FUNC)
-    {
-      unsigned int scope_index;
-      struct Statement scope_statement;
-      ASTHandle scope_handle;
-      ASTHandle *func_args;
-      struct AST *func_node;
-
-
-      /* get function name */
-      const char *func_name = t_arr[s.start + 1].string;
-      /* parse function arguments */
-      func_args = parse_arguments_surrounded_by_parens (t_arr, s.start + 2);
-      /* parse function scope */
-      scope_index = s.start;
-      while (t_arr[scope_index].value != '{')
-        scope_index++;
-      scope_statement.start = scope_index;
-      scope_statement.end = s.end;
-      scope_handle = parse_scope (t_arr, scope_statement);
-
-      /* fill out the func ast node */
-      node = ast_get_node_handle ();
-      func_node = ast_get_node (node);
-      func_node->type = AST_FUNC;
-      func_node->d.func_data.name = func_name;
-      func_node->d.func_data.args = func_args;
-      func_node->d.func_data.scope = scope_handle;
+  TValue v = parser_peek (p, 0);
+  TValue next = parser_peek (p, 1);
+  op->token_count = 1;
+  op->comparison = false;
+  switch (v)
+    {
+    case '+':
+    case '-':
+      op->precedence = PRECEDENCE_ADDITIVE;
+      op->op = v;
+      return true;
+    case '*':
+    case '/':
+      op->precedence = PRECEDENCE_MULTIPLICATIVE;
+      op->op = v;
+      return true;
+    case '<':
+    case '>':
+      op->precedence = PRECEDENCE_COMPARISON;
+      op->comparison = true;
+      op->type = v == '<' ? BOP_LESS_THAN : BOP_GREATER_THAN;
+      return true;
+    case '=':
+    case '!':
+      /* a lone '=' is an assignment, not an operator */
+      if (next != '=')
+        return false;
+      op->precedence = PRECEDENCE_COMPARISON;
+      op->token_count = 2;
+      op->comparison = true;
+      op->type = v == '=' ? BOP_EQUAL : BOP_NOT_EQUAL;
+      return true;
+    default:
+      return false;
     }
-  return node;
 }
 
 ASTHandle
-parse_binary_op_bool_statement (struct Token *t_arr,
-                                struct Statement s_indexes,
-                                unsigned int op_index,
-                                BinaryOpBoolType type)
+parse_statement (struct Parser *p)
 {
-  ASTHandle node = 0;
-  struct Statement left_statement, right_statement;
-  ASTHandle left_handle, right_handle;
-  struct AST *equality_ast;
-
-  /* split the statement into two, left expr and right */
-  left_statement.start = s_indexes.start;
-  left_statement.end = op_index - 1;
-
-  switch (type)
-    {
-    case BOP_EQUAL:
-    case BOP_NOT_EQUAL:
-      right_statement.start = op_index + 2;
+  ASTHandle node;
+  switch (parser_peek (p, 0))
+    {
+    case STATEMENT_DELIM:
+      /* empty statement */
+      parser_advance (p);
+      return 0;
+    case TOK_IF:
+      return parse_if_statement (p);
+    case TOK_FUNC:
+      return parse_function (p);
+    case TOK_WHILE:
+      return parse_while_statement (p);
+    case TOK_FOR:
+      return parse_for_statement (p);
+    case TOK_ELSE:
+      parser_error (p, "else without an if");
       break;
-    case BOP_LESS_THAN:
-    case BOP_GREATER_THAN:
-      right_statement.start = op_index + 1;
+    default:
+      node = parse_simple_statement (p);
       break;
     }
-  right_statement.end = s_indexes.end;
-
-  /* parse the left and right statements into ast nodes */
-  left_handle = parse_statement (t_arr, left_statement);
-  right_handle = parse_statement (t_arr, right_statement);
 
-  /* create a new ast node for the equality statement */
-  node = ast_get_node_handle ();
-  equality_ast = ast_get_node (node);
-  equality_ast->type = AST_BINARY_COMPARATOR;
-  equality_ast->d.bcmp_data.left = left_handle;
-  equality_ast->d.bcmp_data.right = right_handle;
-  equality_ast->d.bcmp_data.type = type;
+  /* the last statement of a scope or file doesn't need a delimiter */
+  if (!parser_match (p, STATEMENT_DELIM)
+      && parser_peek (p, 0) != '}'
+      && p->index < p->count)
+    parser_error (p, "expected ';'");
 
-  /* don't need to keep moving through the for loop */
+  #ifdef PARSER_DEBUG
+  printf ("DEBUG Statement: %u\n", (unsigned int) ast_get_node (node)->type);
+  #endif
   return node;
 }
 
-
 ASTHandle
-parse_possible_equality (struct Token *t_arr, struct Statement s_indexes)
+parse_simple_statement (struct Parser *p)
 {
-  ASTHandle node = 0;
-  /* FORMAT
-   * Left_Expr == Right_Expr */
-  unsigned int i;
-  for (i = s_indexes.start; i < s_indexes.end; i++)
-    {
-      if (i < s_indexes.end - 1)
-        {
-          if (t_arr[i].value == '='  && t_arr[i+1].value == '=')
-            return parse_binary_op_bool_statement (t_arr, s_indexes, i, BOP_EQUAL);
-          else if (t_arr[i].value == '!' && t_arr[i+1].value == '=')
-            return parse_binary_op_bool_statement (t_arr, s_indexes, i, BOP_NOT_EQUAL);
-        }
-      if (t_arr[i].value == '<')
-        return parse_binary_op_bool_statement (t_arr, s_indexes, i, BOP_LESS_THAN);
-      else if (t_arr[i].value == '>')
-        return parse_binary_op_bool_statement (t_arr,
-                                               s_indexes, 
-                                               i,
-                                               BOP_GREATER_THAN);
-
-
-    }
-  return node;
-}
-ASTHandle
-parse_possible_bool(struct Token* t_arr, struct Statement s)
-{
-  ASTHandle node = 0;
-  if ((statement_size(s) >= 2 &&
-      t_arr[s.start].value == TOK_BOOL &&
-      t_arr[s.start + 1].value == STATEMENT_DELIM) ||
-      (statement_size (s) == 1 && t_arr[s.start].value == TOK_BOOL))
-    {
-      struct AST *n = NULL;
-      const struct Token *tok = &t_arr[s.start];
-      node = ast_get_node_handle ();
-      n = ast_get_node (node);
-
-      n->type = AST_BOOL;
-      if (0 == strncmp (tok->string, "true", 4))
-        n->d.bool_data.value = true;
-      else if (0 == strncmp (tok->string, "false", 5))
-        n->d.bool_data.value = false;
-    }
-  return node;
+  if (parser_peek (p, 0) == TOK_IDENTIFIER
+      && parser_peek (p, 1) == '='
+      && parser_peek (p, 2) != '=')
+    return parse_assignment (p);
+  return parse_expression (p, PRECEDENCE_COMPARISON);
 }
-ASTHandle
-parse_possible_if_statement (struct Token *t_arr, struct Statement s)
-{
-  ASTHandle node = 0;
-  if (t_arr[s.start].value == TOK_IF)
-    {
-      /* statement inside parens should evaluate to a bool */
-      /* there should be exactly 1 expression inside if parens */
-      struct AST *n = NULL;
-      ASTHandle expr = 0;
-	    ASTHandle scope_if_true = 0;
-      ASTHandle scope_if_false = 0;
-      struct Statement paren_statement;
-      struct Statement scope_statement;
-      unsigned int next_statement_index = s.end + 1;
-      struct Statement next_statement;
-      unsigned int i = s.start + 2; /* skip over the '(' character */
-      while (t_arr[i].value != ')')
-        i++;
-      paren_statement.start = s.start + 2;
-      paren_statement.end = i-1;
-      expr = parse_statement (t_arr, paren_statement); 
-
-      /* create if ast node */
-      node = ast_get_node_handle();
- 
-      /* find the start of the if scope */
-      while (t_arr[i].value != '{')
-        i++;
-      scope_statement.start = i;
-      scope_statement.end = s.end;
-      /* make sure we don't have an empty scope */
-      if (statement_size (scope_statement) > 2)
-        scope_if_true = parse_scope (t_arr, scope_statement);
-	  
-      /* if there subsequent if else statements, add them to the ast node */
-      next_statement = get_statement (t_arr, &next_statement_index);
-      if (t_arr[next_statement.start].value == TOK_ELSE) 
-        {
-	        if (next_statement.start < ARRAY_COUNT (t_arr))
-            {
-              if (t_arr[next_statement.start].value == TOK_ELSE)
-                {
-                  struct Statement else_statement;
-                  /* we just want the scope part */
-                  else_statement.start = next_statement.start + 1;
-                  else_statement.end = next_statement.end;
-                  scope_if_false = parse_scope (t_arr, else_statement);           
-
-                  /* update the original statement index so the parser
-                  * can skip the trailing parts of if */
-                  global_statement_index = next_statement_index + 1;
-                }
-	          }
-        }
 
-    
-      n = ast_get_node (node);
-      n->d.if_data.scope_if_true = scope_if_true;
-      n->d.if_data.scope_if_false = scope_if_false;
-      n->d.if_data.expr = expr;
-      n->type = AST_IF;
-    }
-  return node;
-}
 ASTHandle
-parse_scope(struct Token* t_arr, struct Statement s)
+parse_scope (struct Parser *p)
 {
-  ASTHandle handle = 0; 
+  ASTHandle handle = 0;
   struct AST *scope = NULL;
-  unsigned int index = s.start + 1; /* skip '{' */
-  unsigned int scope_number = 1;
   ASTHandle *statements = NULL;
 
-  assert (t_arr[s.start].value == '{');
-
-  if (s.start + 1 == s.end)
-    return handle;
-
-  handle = ast_get_node_handle ();
-  while (scope_number != 0 )
+  parser_expect (p, '{', "'{'");
+  while (!parser_match (p, '}'))
     {
       ASTHandle statement;
-      struct Statement statement_indexes = get_statement(t_arr, &index);
-
-      /* this kind of sucks that we have to test for things we
-       * should ignore, but complicating the get_statement logic
-       * to accomodate for if and else statements being one statement
-       * instead of two is not worth it */
-      if (t_arr[statement_indexes.start].value != TOK_ELSE)
+      if (p->index >= p->count)
+        parser_error (p, "expected '}'");
+      statement = parse_statement (p);
+      if (statement)
         {
-          statement = parse_statement (t_arr, statement_indexes);
           ARRAY_PUSH (statements, statement);
         }
-
-      if (t_arr[index].value == '}')
-        scope_number--;
-      if (t_arr[index].value == '{')
-        scope_number++;
-
-      if (scope_number <= 0)
-        break;
     }
-  
+  if (!statements)
+    return handle;
+
+  handle = ast_new_node (AST_SCOPE);
   scope = ast_get_node (handle);
-  scope->type = AST_SCOPE;
   scope->d.scope_data.statements = statements;
   return handle;
 }
 
 ASTHandle
-parse_possible_integer (struct Token *t_arr, struct Statement s)
+parse_if_statement (struct Parser *p)
 {
   ASTHandle node = 0;
-  if ((statement_size (s) >= 2 && 
-      t_arr[s.start].value == TOK_INTEGER &&
-      t_arr[s.start + 1].value == STATEMENT_DELIM) ||
-      (statement_size (s) == 1 &&
-       t_arr[s.start].value == TOK_INTEGER))
-    { /* INTEGER literal */
-      struct AST *n;
+  struct AST *n = NULL;
+  ASTHandle expr = 0;
+  ASTHandle scope_if_true = 0;
+  ASTHandle scope_if_false = 0;
 
-      node = ast_get_node_handle ();
-      n = ast_get_node (node);
-      n->type = AST_INTEGER;
-      n->d.int_data.value = atof (t_arr[s.start].string);
-    }
-  return node;
-}
+  parser_expect (p, TOK_IF, "if");
+  /* statement inside parens should evaluate to a bool */
+  parser_expect (p, '(', "'(' after if");
+  expr = parse_expression (p, PRECEDENCE_COMPARISON);
+  parser_expect (p, ')', "')' after the if condition");
+  scope_if_true = parse_scope (p);
 
-bool32
-is_arithmetic_op (TValue v)
-{
-  return (v == '+' || v == '-' || v == '/' || v == '*');
-}
-
-bool32
-greater_precedence (const char left, const char right)
-{
-  if ('*' == left)
-    {
-      if (right == '+' || right == '-')
-        return true;
-    }
-  else if ('/' == left)
+  if (parser_match (p, TOK_ELSE))
     {
-      if (right == '+' || right == '-')
-        return true;
-    }
-  return false;
-}
-bool32
-equal_precedence (const char left, const char right)
-{
-  if (('+' == left || '-' == left)
-      && ('+' == right || '-' == right))
-    {
-      return true;
-    }
-  if (('*' == left || '/' == left)
-      && ('*' == right || '/' == right))
-    {
-      return true;
-    }
-  return false;
-}
-
-QUEUE (ASTHandleQueue)
-convert_infix_to_postfix (QUEUE (ASTHandleQueue) * expr_q)
-{
-  STACK (ASTHandleStack) s;
-  QUEUE (ASTHandleQueue) q;
-  STACK_STRUCT_INIT (TokenStack, &s, ASTHandle, 10);
-  QUEUE_STRUCT_INIT (TokenQueue, &q, ASTHandle, 10);
-  while (!QUEUE_EMPTY (expr_q))
-    {
-      ASTHandle n = QUEUE_FRONT (expr_q);
-      QUEUE_POP (expr_q);
-      struct AST *ast = ast_get_node (n);
-      if (ast->type != AST_OP)
+      if (parser_peek (p, 0) == TOK_IF)
         {
-          QUEUE_PUSH (&q, n);
+          /* else if, the else scope holds just the next if */
+          ASTHandle *statements = NULL;
+          struct AST *scope;
+          ARRAY_PUSH (statements, parse_if_statement (p));
+          scope_if_false = ast_new_node (AST_SCOPE);
+          scope = ast_get_node (scope_if_false);
+          scope->d.scope_data.statements = statements;
         }
-      else if (ast->type == AST_OP)
+      else
         {
-          if (!STACK_EMPTY (&s))
-            {
-              ASTHandle top = STACK_FRONT (&s);
-              struct AST *top_node = ast_get_node (top);
-
-              const char left = top_node->d.op_data.op;
-              const char right = ast->d.op_data.op;
-              while ((greater_precedence (left, right))
-                     || ((equal_precedence (left, right))
-                         && (left != ')')))
-                {
-                  STACK_POP (&s);
-                  QUEUE_PUSH (&q, top);
-
-                  if (STACK_EMPTY (&s))
-                    break;
-                  top = STACK_FRONT (&s);
-                }
-            }
-          STACK_PUSH (&s, n);
+          scope_if_false = parse_scope (p);
         }
-      if (ast->type == AST_PAREN)
-      {
-        if (ast->d.paren_data.val == '(')
-          {
-            STACK_PUSH (&s, n);
-          }
-        else
-          {
-            ASTHandle tn = STACK_FRONT (&s);
-            struct AST *tn_node = ast_get_node (tn);
-            STACK_POP (&s);
-            while (tn_node->type != AST_PAREN && tn_node->d.paren_data.val != '(')
-              {
-                QUEUE_PUSH (&q, tn);
-                tn = STACK_FRONT (&s);
-                tn_node = ast_get_node (tn);
-                STACK_POP (&s);
-              }
-          }
-      }
-      /*
-      if (n->value == STATEMENT_DELIM)
-        break;
-        */
     }
-  while (!STACK_EMPTY (&s))
-    {
-      ASTHandle tn = STACK_FRONT (&s);
-      STACK_POP (&s);
-      QUEUE_PUSH (&q, tn);
-    }
-  STACK_FREE (&s, TokenStack);
-  QUEUE_FREE (expr_q, TokenQueue);
-  return q;
-}
-ASTHandle
-convert_postfix_to_ast (QUEUE (ASTHandleQueue) * postfix_q)
-{
-  STACK (ASTHandleStack) s;
-  ASTHandle return_handle;
-  STACK_STRUCT_INIT (ASTHandleStack, &s, ASTHandle, 10);
-  while (!QUEUE_EMPTY (postfix_q))
-    {
-      ASTHandle n = QUEUE_FRONT (postfix_q);
-      struct AST *n_node = ast_get_node (n);
-      QUEUE_POP (postfix_q);
 
-      if (n_node->type != AST_OP)
-        {
-          STACK_PUSH (&s, n);
-        }
-      else if (n_node->type == AST_OP)
-        {
-          ASTHandle left, right, ast_handle;
-          struct AST *op;
-
-          /* Remove the first two elements from the stack.
-             They will be the left and right params of a binary op */
-          left = STACK_FRONT (&s);
-          STACK_POP (&s);
-          right = STACK_FRONT (&s);
-          STACK_POP (&s);
-          ast_handle = ast_get_node_handle ();
-          n_node = ast_get_node (n); /* re-get n_node pointer */
-
-          /* Fill out information of binary op */
-          op = ast_get_node (ast_handle);
-          op->type = AST_BINARY_OP;
-          op->d.bop_data.left = left;
-          op->d.bop_data.right = right;
-          op->d.bop_data.op = n_node->d.op_data.op;
-          /* Insert the operation, instead of the left and right values */
-          STACK_PUSH (&s, ast_handle);
-        }
-    }
-  return_handle = STACK_FRONT (&s);
-  STACK_FREE (&s, ASTHandleStack);
-  QUEUE_FREE (postfix_q, TokenQueue);
-  return return_handle;
+  node = ast_new_node (AST_IF);
+  n = ast_get_node (node);
+  n->d.if_data.expr = expr;
+  n->d.if_data.scope_if_true = scope_if_true;
+  n->d.if_data.scope_if_false = scope_if_false;
+  return node;
 }
 
 ASTHandle
-parser__arithmetic (struct Token *t_arr, struct Statement s)
+parse_while_statement (struct Parser *p)
 {
-  /* storage necessary to put tokens into a queue/stack
-     no more memory should be allocated for this process */
-  QUEUE (ASTHandleQueue) expr_q = { 0 };
-  QUEUE (ASTHandleQueue) postfix = { 0 };
-  unsigned int i;
-  ASTHandle op;
+  ASTHandle node;
+  struct AST *n;
+  ASTHandle expr;
 
-  QUEUE_STRUCT_INIT (ASTHandleQueue, &expr_q, ASTHandle, 10);
+  parser_expect (p, TOK_WHILE, "while");
+  parser_expect (p, '(', "'(' after while");
+  expr = parse_expression (p, PRECEDENCE_COMPARISON);
+  parser_expect (p, ')', "')' after the while condition");
 
-  unsigned int start_index = s.start;
-  for (i = s.start; i < s.end; i++)
-    {
-      if (is_arithmetic_op (t_arr[i].value))
-        {
-          struct Statement sub_statement = { start_index, i-1 };
-          ASTHandle h = parse_statement (t_arr, sub_statement);
-          QUEUE_PUSH (&expr_q, h);
-
-          struct Statement op_statement = { i, i };
-          h = parse_statement (t_arr, op_statement);
-          QUEUE_PUSH (&expr_q, h);
-          
-          start_index = i + 1;
-        }
-    }
-  struct Statement sub_statement = { start_index, i };
-  ASTHandle h = parse_statement (t_arr, sub_statement);
-  QUEUE_PUSH (&expr_q, h);
-  start_index = i + 1;
-
-  postfix = convert_infix_to_postfix (&expr_q);
-  op = convert_postfix_to_ast (&postfix);
-  return op;
-}
-
-void debug_print_queue (QUEUE (TokenQueue) * q)
-{
-  struct Token *np;
-  int i;
-
-  for (i = q->head; i <= q->tail; i++)
-    {
-      np = q->mem[i];
-      if (np->value < 128)
-        printf ("Value: %c ", np->value);
-      else
-        printf ("Value: %d ", np->value);
-      if (np->string)
-        printf ("String: %s", np->string);
-      printf ("\n");
-    }
+  node = ast_new_node (AST_WHILE);
+  n = ast_get_node (node);
+  n->d.while_data.expr = expr;
+  n->d.while_data.scope = parse_scope (p);
+  return node;
 }
 
-bool32
-contains_invalid_arithmetic_token (struct Token *t_arr, struct Statement s)
+ASTHandle
+parse_for_statement (struct Parser *p)
 {
-  unsigned int i;
-  for (i = s.start; i < s.end; i++)
-    {
-      if (t_arr[i].value == '=')
-        return true;
-    }
-  return false;
+  ASTHandle node;
+  struct AST *n;
+  ASTHandle init = 0;
+  ASTHandle expr;
+  ASTHandle step = 0;
+
+  parser_expect (p, TOK_FOR, "for");
+  parser_expect (p, '(', "'(' after for");
+  if (!parser_match (p, STATEMENT_DELIM))
+    {
+      init = parse_simple_statement (p);
+      parser_expect (p, STATEMENT_DELIM, "';' after the for initializer");
+    }
+  expr = parse_expression (p, PRECEDENCE_COMPARISON);
+  parser_expect (p, STATEMENT_DELIM, "';' after the for condition");
+  if (parser_peek (p, 0) != ')')
+    step = parse_simple_statement (p);
+  parser_expect (p, ')', "')' after the for step");
+
+  node = ast_new_node (AST_FOR);
+  n = ast_get_node (node);
+  n->d.for_data.init = init;
+  n->d.for_data.expr = expr;
+  n->d.for_data.step = step;
+  n->d.for_data.scope = parse_scope (p);
+  return node;
 }
 
 ASTHandle
-parse_possible_arithmetic (struct Token *t_arr, struct Statement s)
+parse_function (struct Parser *p)
 {
   ASTHandle node = 0;
-  /* Expression Format:
-   * a + b ...
-   * (a / b ... */
-  if (statement_size (s) <= 1)
-    return node;
-  size_t i;
-  for (i = s.start; i <= s.end ; i++)
-    {
-      if (is_arithmetic_op(t_arr[i].value))
+  struct AST *func_node;
+  ASTHandle *func_args = NULL;
+  ASTHandle scope_handle;
+  Symbol func_name;
+
+  parser_expect (p, TOK_FUNC, "func");
+  func_name = parser_token_symbol (p,
+                                   parser_expect (p,
+                                                  TOK_IDENTIFIER,
+                                                  "a function name"));
+  parser_expect (p, '(', "'(' after the function name");
+  if (!parser_match (p, ')'))
+    {
+      do
         {
-          node = parser__arithmetic (t_arr, s);
+          struct AST *arg;
+          Symbol arg_name;
+          ASTHandle arg_handle;
+          arg_name = parser_token_symbol (p,
+                                          parser_expect (p,
+                                                         TOK_IDENTIFIER,
+                                                         "an argument name"));
+          arg_handle = ast_new_node (AST_IDENTIFIER);
+          arg = ast_get_node (arg_handle);
+          arg->d.id_data.id = arg_name;
+          ARRAY_PUSH (func_args, arg_handle);
         }
+      while (parser_match (p, ','));
+      parser_expect (p, ')', "')' after the function arguments");
     }
+  scope_handle = parse_scope (p);
+
+  /* fill out the func ast node */
+  node = ast_new_node (AST_FUNC);
+  func_node = ast_get_node (node);
+  func_node->d.func_data.name = func_name;
+  func_node->d.func_data.args = func_args;
+  func_node->d.func_data.scope = scope_handle;
   return node;
 }
 
 ASTHandle
-parse_possible_identifier (struct Token *t_arr, struct Statement s)
+parse_assignment (struct Parser *p)
 {
   ASTHandle node = 0;
-  if ((statement_size (s) == 1 && t_arr[s.start].value == TOK_IDENTIFIER) ||
-      (statement_size (s) == 2 && t_arr[s.start].value == TOK_IDENTIFIER &&
-       t_arr[s.start + 1].value == STATEMENT_DELIM))
+  struct AST *n = NULL;
+  Symbol var = parser_token_symbol (p,
+                                   parser_expect (p,
+                                                  TOK_IDENTIFIER,
+                                                  "a variable"));
+  ASTHandle expr;
+
+  parser_expect (p, '=', "'='");
+  expr = parse_expression (p, PRECEDENCE_COMPARISON);
+
+  node = ast_new_node (AST_ASSIGNMENT);
+  n = ast_get_node (node);
+  n->d.asgn_data.var = var;
+  n->d.asgn_data.expr = expr;
+  return node;
+}
+
+ASTHandle
+parse_expression (struct Parser *p, int min_precedence)
+{
+  ASTHandle left = parse_primary (p);
+  struct ParserOperator op;
+
+  while (parser_peek_operator (p, &op) && op.precedence >= min_precedence)
     {
-      struct AST *n = NULL;
-      node = ast_get_node_handle ();
+      ASTHandle node;
+      ASTHandle right;
+      struct AST *n;
+
+      p->index += op.token_count;
+      right = parse_expression (p, op.precedence + 1);
+
+      node = ast_new_node (op.comparison ? AST_BINARY_COMPARATOR
+                                         : AST_BINARY_OP);
       n = ast_get_node (node);
-      n->type = AST_IDENTIFIER;
-      n->d.id_data.id = t_arr[s.start].string;
+      if (op.comparison)
+        {
+          n->d.bcmp_data.left = left;
+          n->d.bcmp_data.right = right;
+          n->d.bcmp_data.type = op.type;
+        }
+      else
+        {
+          n->d.bop_data.left = left;
+          n->d.bop_data.right = right;
+          n->d.bop_data.op = op.op;
+        }
+      left = node;
     }
-  return node;
+  return left;
 }
 
 ASTHandle
-parse_possible_string (struct Token *t_arr, struct Statement s)
+parse_primary (struct Parser *p)
 {
   ASTHandle node = 0;
-  if ((statement_size (s) == 1 &&
-       t_arr[s.start].value == TOK_STRING) ||
-      (statement_size (s) >= 2 &&
-      t_arr[s.start].value == TOK_STRING &&
-      t_arr[s.start + 1].value == STATEMENT_DELIM))
+  struct AST *n = NULL;
+  unsigned int t = p->index;
+  const char *text;
+
+  /* at the end of input t is past the last token, so only the
+   * cases that consume a token look at its text */
+  switch (parser_peek (p, 0))
     {
-      struct AST *n = NULL;
-      node = ast_get_node_handle ();
+    case '(':
+      parser_advance (p);
+      node = parse_expression (p, PRECEDENCE_COMPARISON);
+      parser_expect (p, ')', "')'");
+      return node;
+    case '[':
+      return parse_list (p);
+    case TOK_IDENTIFIER:
+      parser_advance (p);
+      if (parser_match (p, '('))
+        {
+          ASTHandle *args = parse_arguments (p, ')');
+          node = ast_new_node (AST_FUNC_CALL);
+          n = ast_get_node (node);
+          n->d.func_call_data.name = parser_token_symbol (p, t);
+          n->d.func_call_data.builtin =
+            AmpleBuiltinFind (SymbolName (n->d.func_call_data.name));
+          n->d.func_call_data.args = args;
+          return node;
+        }
+      node = ast_new_node (AST_IDENTIFIER);
+      n = ast_get_node (node);
+      n->d.id_data.id = parser_token_symbol (p, t);
+      return node;
+    case TOK_INTEGER:
+      {
+        /* strtod would read past the token in "1e5" or "0x1" */
+        char number[64];
+        size_t length = TokenLength (p->tokens, t);
+        text = p->source + p->tokens->starts[t];
+        if (length > sizeof (number) - 1)
+          length = sizeof (number) - 1;
+        memcpy (number, text, length);
+        number[length] = '\0';
+        parser_advance (p);
+        node = ast_new_node (AST_INTEGER);
+        n = ast_get_node (node);
+        n->d.int_data.value = atof (number);
+        return node;
+      }
+    case TOK_STRING:
+      parser_advance (p);
+      node = ast_new_node (AST_STRING);
       n = ast_get_node (node);
-      n->type = AST_STRING;
-      n->d.str_data.str = t_arr[s.start].string;
+      n->d.str_data.str = parser_token_string (p, t);
+      return node;
+    case TOK_BOOL:
+      text = p->source + p->tokens->starts[t];
+      parser_advance (p);
+      node = ast_new_node (AST_BOOL);
+      n = ast_get_node (node);
+      n->d.bool_data.value = TokenLength (p->tokens, t) == 4
+                              && 0 == memcmp (text, "true", 4);
+      return node;
+    default:
+      parser_error (p, "expected an expression");
+      return node;
     }
-  return node;
 }
 
 ASTHandle
-parse_possible_assignment (struct Token *t_arr, struct Statement s)
+parse_list (struct Parser *p)
 {
   ASTHandle node = 0;
-  /* VAR = EXPR */
-  if (statement_size (s) >= 3 && t_arr[s.start].value == TOK_IDENTIFIER
-      && t_arr[s.start + 1].value == '=' && t_arr[s.start + 2].value != '=')
-    {
-      struct Statement sub_statement;
-      struct AST ast;
-      struct AST *n = NULL;
-      node = ast_get_node_handle ();
+  struct AST *n = NULL;
+  ASTHandle *items;
 
-      sub_statement.start = s.start + 2;
-      sub_statement.end = s.end;
-      ast.type = AST_ASSIGNMENT;
-      ast.d.asgn_data.var = t_arr[s.start].string;
-      ast.d.asgn_data.expr = parse_statement (t_arr, sub_statement);
+  parser_expect (p, '[', "'['");
+  items = parse_arguments (p, ']');
 
-      n = ast_get_node (node);
-      *n = ast;
-    }
+  node = ast_new_node (AST_LIST);
+  n = ast_get_node (node);
+  n->d.list_data.items = items;
   return node;
 }
-void
-debug_print_statement(struct Token* t_arr, struct Statement s)
+
+ASTHandle *
+parse_arguments (struct Parser *p, TValue close)
 {
-  unsigned int i;
-  for (i = s.start; i <= s.end; i++)
+  ASTHandle *parsed_arguments = NULL;
+  if (parser_match (p, close))
+    return parsed_arguments;
+  do
     {
-      if (t_arr[i].value <= 125)
-        printf ("Token %d: %c\n", i - s.start, t_arr[i].value);
-      else
-        printf ("Token %d: %s\n", i - s.start, t_arr[i].string);
+      ARRAY_PUSH (parsed_arguments,
+                  parse_expression (p, PRECEDENCE_COMPARISON));
     }
+  while (parser_match (p, ','));
+  if (!parser_match (p, close))
+    parser_error (p, close == ')' ? "expected ')'" : "expected ']'");
+  return parsed_arguments;
+}
+
+void
+debug_print_token (const char *source,
+                   const struct TokenStream *tokens,
+                   unsigned int token)
+{
+  if (token >= tokens->count)
+    printf ("end of file");
+  else
+    printf ("\"%.*s\"",
+            (int) TokenLength (tokens, token),
+            source + tokens->starts[token]);
 }
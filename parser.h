@@ -18,95 +18,85 @@
 #define PARSER_H_
 #include "ast.h"
 #include "lexer.h"
-#include "queue.h"
-#include "stack.h"
 #define STATEMENT_DELIM ';'
-struct Token;
-ASTHandle ParseTokens(struct Token *tokens);
+/* source is the buffer the tokens were lexed from */
+ASTHandle ParseTokens(const char *source, const struct TokenStream *tokens);
 
 /* ******************
  * internal functions
  * ****************** */
-/* A subset of the token array */
-struct Statement {
-  unsigned int start;
-  unsigned int end;
+/* The parser reads the token array once from left to right, every
+ * parse_* function consumes exactly the tokens of what it parses */
+struct Parser {
+  const char *source;
+  const struct TokenStream *tokens;
+  unsigned int index;
+  unsigned int count;
 };
-/* Returns a statement struct containing the start and
-   end index of the next statement in the token array */
-struct Statement get_statement(struct Token *__restrict tokens,
-                                      unsigned int *__restrict index);
-/* returns the number of tokens that make up a statement */
-unsigned int statement_size(struct Statement s);
-/* Parsers *any* statement or substatement */
-ASTHandle parse_statement(struct Token *t_arr, struct Statement s);
 
-/* ========================================================
-    Possible parsers
-    Return a valid node if the statement is actually of X ast type
-   ======================================================== */
-ASTHandle parse_possible_integer(struct Token *t_arr, struct Statement s);
-ASTHandle parse_possible_identifier(struct Token *t_arr, struct Statement s);
-ASTHandle parse_possible_arithmetic(struct Token *t_arr, struct Statement s);
-ASTHandle parse_possible_string(struct Token *t_arr, struct Statement s);
-ASTHandle parse_possible_list(struct Token *t_arr, struct Statement s);
-ASTHandle parse_list (struct Token *t_arr,
-                      struct Statement s,
-                      unsigned int *end_index);
-ASTHandle parse_possible_assignment(struct Token *t_arr,
-                                    struct Statement s);
-ASTHandle parse_possible_if_statement (struct Token *t_arr,
-                                       struct Statement s);
-ASTHandle parse_possible_bool (struct Token *t_arr,
-                               struct Statement s);
-ASTHandle parse_possible_equality (struct Token *t_arr,
-                                   struct Statement s_indexes);
-ASTHandle parse_possible_function(struct Token *t_arr,
-                                  struct Statement s);
-ASTHandle parse_scope (struct Token *t_arr,
-                       struct Statement s);
-/* returns an array of ast handles that should be freed with ARRAY_FREE */
-ASTHandle *parse_arguments(struct Token *t_arr,
-                           struct Statement s);
-/* returns an array of ast handles that should be freed with ARRAY_FREE */
-ASTHandle * parse_arguments_surrounded_by_parens (struct Token *t_arr,
-                                                  unsigned int start_index);
-ASTHandle parse_possible_function_call(struct Token *t_arr,
-                                       struct Statement s);
-
-/* ===================
-    Arithmetic helpers
-   =================== */
-bool32 is_arithmetic_op(TValue v);
-/* true if left is of greater operator precedence than right */
-bool32 greater_precedence(const char left, const char right);
-/* true if left is of equal operator precedence than right */
-bool32 equal_precedence(const char left, const char right);
-/* checks if there are any tokens that don't make sense
- * in an arithmetic statement */
-bool32 contains_invalid_arithmetic_token (struct Token *t_arr,
-                                          struct Statement s);
+/* a binary operator, which can span two tokens ("==", "!=") */
+struct ParserOperator {
+  int precedence; /* higher binds tighter */
+  unsigned int token_count;
+  bool32 comparison;
+  TValue op; /* arithmetic operators */
+  BinaryOpBoolType type; /* comparison operators */
+};
+#define PRECEDENCE_COMPARISON 1
+#define PRECEDENCE_ADDITIVE 2
+#define PRECEDENCE_MULTIPLICATIVE 3
 
-/* ==================
-    Arithmetic parsing
-   ==================*/
-STACK_DECLARATION(TokenStack, struct Token *);
-QUEUE_DECLARATION(TokenQueue, struct Token *);
+/* returns the kind of the token "ahead" tokens past the current one,
+ * past the end of the stream it's 0 */
+TValue parser_peek(struct Parser *p, unsigned int ahead);
+/* returns the index of the consumed token */
+unsigned int parser_advance(struct Parser *p);
+/* consumes the current token if it has value v */
+bool32 parser_match(struct Parser *p, TValue v);
+/* consumes a token that has to have value v */
+unsigned int parser_expect(struct Parser *p, TValue v, const char *what);
+void parser_error(struct Parser *p, const char *message);
+/* copies the text of a token into the tree */
+char *parser_token_string(struct Parser *p, unsigned int token);
+/* interns the text of an identifier token */
+Symbol parser_token_symbol(struct Parser *p, unsigned int token);
+/* fills out op if the current tokens are a binary operator */
+bool32 parser_peek_operator(struct Parser *p, struct ParserOperator *op);
 
-STACK_DECLARATION(ASTHandleStack, ASTHandle);
-QUEUE_DECLARATION(ASTHandleQueue, ASTHandle);
-/* converts a normal mathematical (infix) expression to something more workable
- */
-QUEUE(ASTHandleQueue) convert_infix_to_postfix(QUEUE(ASTHandleQueue) * expr_q);
-/* converts a postfix expression gotten from convert_infix_to_postfix into an
- * ast */
-ASTHandle convert_postfix_to_ast(QUEUE(ASTHandleQueue) * infix_q);
+/* Parses *any* statement */
+ASTHandle parse_statement(struct Parser *p);
+/* { statements }, returns 0 for an empty scope */
+ASTHandle parse_scope(struct Parser *p);
+/* an assignment or an expression, without the delimiter */
+ASTHandle parse_simple_statement(struct Parser *p);
+/* if (expr) scope [else scope | else if ...] */
+ASTHandle parse_if_statement(struct Parser *p);
+/* while (expr) scope */
+ASTHandle parse_while_statement(struct Parser *p);
+/* for ([init]; expr; [step]) scope */
+ASTHandle parse_for_statement(struct Parser *p);
+/* func name (arg, ...) scope */
+ASTHandle parse_function(struct Parser *p);
+/* VAR = EXPR */
+ASTHandle parse_assignment(struct Parser *p);
+/* parses operators that bind at least as tight as min_precedence,
+ * operators of equal precedence group to the left */
+ASTHandle parse_expression(struct Parser *p, int min_precedence);
+/* literals, variables, function calls, lists and parenthesized
+ * expressions */
+ASTHandle parse_primary(struct Parser *p);
+/* [ A, B, C ] */
+ASTHandle parse_list(struct Parser *p);
+/* comma separated expressions up to and including the close token,
+ * returns an array of ast handles that should be freed with ARRAY_FREE */
+ASTHandle *parse_arguments(struct Parser *p, TValue close);
 
 /* ==============
     Debug output
    ============== */
-void debug_print_queue(QUEUE(TokenQueue) * q);
-void debug_print_statement(struct Token* t_arr, struct Statement s);
+void debug_print_token(const char *source,
+                       const struct TokenStream *tokens,
+                       unsigned int token);
 
 /* ************************************************************************* */
 
@@ -0,0 +1,287 @@
+/*
+    This file is part of Ample.
+
+    Ample is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ample is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ample.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "resolver.h"
+#include "array.h"
+#include "ast.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+struct ResolverScope {
+  Symbol **locals; /* the locals array of a scope or function node */
+};
+/* a variable found in a scope that isn't the global one. A block only
+ * gets a frame if it ends up binding names, the uses inside it that
+ * reach past a block without one are one frame closer than counted */
+struct ResolverUse {
+  struct VarLocation *loc;
+  size_t scope; /* index in resolver_scopes of the scope it's in */
+};
+
+static Symbol **resolver_globals;
+/* the scopes visible from the code being resolved, the innermost one
+ * is last. The global scope is never in here */
+static struct ResolverScope *resolver_scopes; /* array */
+static ASTHandle *resolver_deferred_functions; /* array */
+static struct ResolverUse *resolver_uses; /* array */
+
+void
+ResolveProgram (ASTHandle head)
+{
+  size_t i;
+  if (!head)
+    return;
+  resolver_globals = &ast_get_node (head)->d.scope_data.locals;
+  resolver_resolve_statements (head);
+
+  /* functions can define functions of their own,
+   * so the array can grow while it's walked */
+  for (i = 0; i < ARRAY_COUNT (resolver_deferred_functions); i++)
+    {
+      resolver_resolve_function (resolver_deferred_functions[i]);
+    }
+  ARRAY_FREE (resolver_deferred_functions);
+  ARRAY_FREE (resolver_scopes);
+  ARRAY_FREE (resolver_uses);
+  resolver_deferred_functions = NULL;
+  resolver_scopes = NULL;
+  resolver_uses = NULL;
+  resolver_globals = NULL;
+}
+
+int
+resolver_find_slot (Symbol *locals, Symbol name)
+{
+  size_t i;
+  for (i = 0; i < ARRAY_COUNT (locals); i++)
+    {
+      if (locals[i] == name)
+        return (int) i;
+    }
+  return -1;
+}
+
+unsigned int
+resolver_declare (Symbol **locals, Symbol name)
+{
+  ARRAY_PUSH ((*locals), name);
+  return ARRAY_COUNT (*locals) - 1;
+}
+
+bool32
+resolver_lookup (Symbol name, struct VarLocation *loc)
+{
+  size_t count = ARRAY_COUNT (resolver_scopes);
+  size_t i = count;
+  int slot;
+  while (i-- > 0)
+    {
+      slot = resolver_find_slot (*resolver_scopes[i].locals, name);
+      if (slot >= 0)
+        {
+          struct ResolverUse use;
+          loc->global = false;
+          loc->depth = count - 1 - i;
+          loc->slot = slot;
+          use.loc = loc;
+          use.scope = i;
+          ARRAY_PUSH (resolver_uses, use);
+          return true;
+        }
+    }
+  slot = resolver_find_slot (*resolver_globals, name);
+  if (slot >= 0)
+    {
+      loc->global = true;
+      loc->depth = 0;
+      loc->slot = slot;
+      return true;
+    }
+  return false;
+}
+
+void
+resolver_resolve_node (ASTHandle handle)
+{
+  struct AST *node = ast_get_node (handle);
+  size_t i;
+  if (!node)
+    return;
+  switch (node->type)
+    {
+    case AST_IDENTIFIER:
+      if (!resolver_lookup (node->d.id_data.id, &node->d.id_data.loc))
+        {
+          /* nothing assigns it, so reading it fails at runtime */
+          node->d.id_data.loc.global = true;
+          node->d.id_data.loc.depth = 0;
+          node->d.id_data.loc.slot = resolver_declare (resolver_globals,
+                                                       node->d.id_data.id);
+        }
+      break;
+    case AST_ASSIGNMENT:
+      {
+        struct VarLocation *loc = &node->d.asgn_data.loc;
+        Symbol var = node->d.asgn_data.var;
+        /* the value is evaluated before the variable exists */
+        resolver_resolve_node (node->d.asgn_data.expr);
+        if (!resolver_lookup (var, loc))
+          {
+            size_t count = ARRAY_COUNT (resolver_scopes);
+            loc->depth = 0;
+            if (count)
+              {
+                loc->global = false;
+                loc->slot = resolver_declare (resolver_scopes[count - 1].locals,
+                                              var);
+              }
+            else
+              {
+                loc->global = true;
+                loc->slot = resolver_declare (resolver_globals, var);
+              }
+          }
+      }
+      break;
+    case AST_BINARY_OP:
+      resolver_resolve_node (node->d.bop_data.left);
+      resolver_resolve_node (node->d.bop_data.right);
+      break;
+    case AST_BINARY_COMPARATOR:
+      resolver_resolve_node (node->d.bcmp_data.left);
+      resolver_resolve_node (node->d.bcmp_data.right);
+      break;
+    case AST_IF:
+      resolver_resolve_node (node->d.if_data.expr);
+      resolver_resolve_block (node->d.if_data.scope_if_true);
+      resolver_resolve_block (node->d.if_data.scope_if_false);
+      break;
+    case AST_WHILE:
+      resolver_resolve_node (node->d.while_data.expr);
+      resolver_resolve_block (node->d.while_data.scope);
+      break;
+    case AST_FOR:
+      /* init and step belong to the scope around the loop */
+      resolver_resolve_node (node->d.for_data.init);
+      resolver_resolve_node (node->d.for_data.expr);
+      resolver_resolve_block (node->d.for_data.scope);
+      resolver_resolve_node (node->d.for_data.step);
+      break;
+    case AST_SCOPE:
+      resolver_resolve_block (handle);
+      break;
+    case AST_FUNC:
+      ARRAY_PUSH (resolver_deferred_functions, handle);
+      break;
+    case AST_FUNC_CALL:
+      for (i = 0; i < ARRAY_COUNT (node->d.func_call_data.args); i++)
+        {
+          resolver_resolve_node (node->d.func_call_data.args[i]);
+        }
+      break;
+    case AST_LIST:
+      for (i = 0; i < ARRAY_COUNT (node->d.list_data.items); i++)
+        {
+          resolver_resolve_node (node->d.list_data.items[i]);
+        }
+      break;
+    default:
+      break;
+    }
+}
+
+void
+resolver_resolve_statements (ASTHandle scope_handle)
+{
+  struct AST *scope = ast_get_node (scope_handle);
+  size_t i;
+  if (!scope)
+    return;
+  for (i = 0; i < ARRAY_COUNT (scope->d.scope_data.statements); i++)
+    {
+      resolver_resolve_node (scope->d.scope_data.statements[i]);
+    }
+}
+
+void
+resolver_resolve_block (ASTHandle scope_handle)
+{
+  struct AST *node = ast_get_node (scope_handle);
+  struct ResolverScope scope;
+  size_t index = ARRAY_COUNT (resolver_scopes);
+  size_t first_use = ARRAY_COUNT (resolver_uses);
+  size_t kept = first_use;
+  size_t i;
+  if (!node)
+    return;
+  scope.locals = &node->d.scope_data.locals;
+  ARRAY_PUSH (resolver_scopes, scope);
+  resolver_resolve_statements (scope_handle);
+  ARRAY_POP (resolver_scopes);
+
+  /* the frame is exactly the slots that were handed out */
+  node->d.scope_data.has_frame = ARRAY_COUNT (node->d.scope_data.locals) > 0;
+  for (i = first_use; i < ARRAY_COUNT (resolver_uses); i++)
+    {
+      struct ResolverUse use = resolver_uses[i];
+      /* uses of the block's own variables are settled */
+      if (use.scope >= index)
+        continue;
+      if (!node->d.scope_data.has_frame)
+        use.loc->depth--;
+      resolver_uses[kept++] = use;
+    }
+  while (ARRAY_COUNT (resolver_uses) > kept)
+    {
+      ARRAY_POP (resolver_uses);
+    }
+}
+
+void
+resolver_resolve_function (ASTHandle func_handle)
+{
+  struct AST *func = ast_get_node (func_handle);
+  struct ResolverScope scope;
+  ASTHandle *args = func->d.func_data.args;
+  size_t i;
+
+  /* the arguments take the first slots of the function */
+  scope.locals = &func->d.func_data.locals;
+  for (i = 0; i < ARRAY_COUNT (args); i++)
+    {
+      struct AST *arg = ast_get_node (args[i]);
+      if (arg->type != AST_IDENTIFIER)
+        {
+          printf ("Function arg specifiers should be identifier\n");
+          exit (1);
+        }
+      arg->d.id_data.loc.global = false;
+      arg->d.id_data.loc.depth = 0;
+      arg->d.id_data.loc.slot = resolver_declare (scope.locals,
+                                                  arg->d.id_data.id);
+    }
+
+  /* the top level of the body shares the function's scope */
+  ARRAY_PUSH (resolver_scopes, scope);
+  resolver_resolve_statements (func->d.func_data.scope);
+  ARRAY_POP (resolver_scopes);
+  /* a function always has a frame, nothing is left to adjust */
+  while (ARRAY_COUNT (resolver_uses) > 0)
+    {
+      ARRAY_POP (resolver_uses);
+    }
+}
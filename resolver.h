@@ -0,0 +1,54 @@
+/*
+    This file is part of Ample.
+
+    Ample is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ample is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ample.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef RESOLVER_H_
+#define RESOLVER_H_
+#include "ast.h"
+/* ******************
+   External functions
+   ****************** */
+/* Gives every variable of the program a fixed slot so it can be
+ * accessed without looking up its name.
+ *
+ * Scoping is lexical: a function sees its own variables and the
+ * globals, a block sees the variables of the blocks around it.
+ * Assigning to a name that is not visible yet creates it in the
+ * innermost scope. Function bodies are resolved after the whole
+ * global scope, so they can use globals that are assigned further
+ * down the file. A name that is read but never assigned anywhere
+ * visible becomes a global that is reported as missing when the
+ * read runs.
+ *
+ * The global names end up in the head scope's locals */
+void ResolveProgram(ASTHandle head);
+
+/* ******************
+   Internal Functions
+   ****************** */
+/* returns the slot of name in locals or -1 */
+int resolver_find_slot(Symbol *locals, Symbol name);
+unsigned int resolver_declare(Symbol **locals, Symbol name);
+/* finds where a visible variable lives, returns false
+ * if no scope can see a variable with that name */
+bool32 resolver_lookup(Symbol name, struct VarLocation *loc);
+void resolver_resolve_node(ASTHandle handle);
+void resolver_resolve_statements(ASTHandle scope_handle);
+/* resolves an if/else or loop body in a scope of its own. Once it's
+ * resolved, a body that bound no names is marked to run in the frame
+ * around it */
+void resolver_resolve_block(ASTHandle scope_handle);
+void resolver_resolve_function(ASTHandle func_handle);
+#endif
@@ -0,0 +1,145 @@
+/*
+    This file is part of Ample.
+
+    Ample is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ample is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ample.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "symbol.h"
+#include "array.h"
+#include "hash.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* names are packed into blocks that are freed together */
+struct SymbolNameBlock {
+  struct SymbolNameBlock *next;
+  size_t used;
+  size_t size;
+  char data[1];
+};
+
+struct SymbolEntry {
+  const char *name;
+  size_t length;
+  size_t hash;
+};
+
+static struct SymbolEntry *symbol_entries; /* array, indexed by Symbol */
+/* open addressing, a slot holds symbol + 1 and 0 when it's empty */
+static Symbol *symbol_slots;
+static size_t symbol_capacity;
+static struct SymbolNameBlock *symbol_names;
+
+Symbol
+SymbolIntern (const char *str, size_t length)
+{
+  size_t hash = hash_bytes (str, length);
+  size_t mask;
+  size_t i;
+  Symbol symbol;
+  struct SymbolEntry entry;
+
+  if (!symbol_slots)
+    {
+      symbol_capacity = SYMBOL_TABLE_INITIAL_CAPACITY;
+      symbol_slots = calloc (symbol_capacity, sizeof (*symbol_slots));
+    }
+  mask = symbol_capacity - 1;
+  for (i = hash & mask; symbol_slots[i] != 0; i = (i + 1) & mask)
+    {
+      struct SymbolEntry *e = &symbol_entries[symbol_slots[i] - 1];
+      if (e->hash == hash && e->length == length
+          && 0 == memcmp (e->name, str, length))
+        return symbol_slots[i] - 1;
+    }
+
+  symbol = ARRAY_COUNT (symbol_entries);
+  entry.name = symbol_copy_name (str, length);
+  entry.length = length;
+  entry.hash = hash;
+  ARRAY_PUSH (symbol_entries, entry);
+  symbol_slots[i] = symbol + 1;
+  /* keep the table at most half full */
+  if (ARRAY_COUNT (symbol_entries) * 2 > symbol_capacity)
+    symbol_grow ();
+  return symbol;
+}
+
+const char *
+SymbolName (Symbol symbol)
+{
+  return symbol_entries[symbol].name;
+}
+
+size_t
+SymbolCount (void)
+{
+  return ARRAY_COUNT (symbol_entries);
+}
+
+void
+SymbolTableFree (void)
+{
+  ARRAY_FREE (symbol_entries);
+  free (symbol_slots);
+  symbol_entries = NULL;
+  symbol_slots = NULL;
+  symbol_capacity = 0;
+  while (symbol_names)
+    {
+      struct SymbolNameBlock *next = symbol_names->next;
+      free (symbol_names);
+      symbol_names = next;
+    }
+}
+
+void
+symbol_grow (void)
+{
+  size_t count = ARRAY_COUNT (symbol_entries);
+  size_t mask;
+  size_t s;
+  free (symbol_slots);
+  symbol_capacity *= 2;
+  symbol_slots = calloc (symbol_capacity, sizeof (*symbol_slots));
+  mask = symbol_capacity - 1;
+  for (s = 0; s < count; s++)
+    {
+      size_t i = symbol_entries[s].hash & mask;
+      while (symbol_slots[i] != 0)
+        i = (i + 1) & mask;
+      symbol_slots[i] = s + 1;
+    }
+}
+
+char *
+symbol_copy_name (const char *str, size_t length)
+{
+  struct SymbolNameBlock *block = symbol_names;
+  char *copy;
+  if (!block || block->used + length + 1 > block->size)
+    {
+      size_t size = length + 1 > SYMBOL_NAME_BLOCK_SIZE
+                      ? length + 1 : SYMBOL_NAME_BLOCK_SIZE;
+      block = malloc (offsetof (struct SymbolNameBlock, data) + size);
+      block->next = symbol_names;
+      block->used = 0;
+      block->size = size;
+      symbol_names = block;
+    }
+  copy = block->data + block->used;
+  memcpy (copy, str, length);
+  copy[length] = '\0';
+  block->used += length + 1;
+  return copy;
+}
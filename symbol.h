@@ -0,0 +1,48 @@
+/*
+    This file is part of Ample.
+
+    Ample is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ample is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ample.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef SYMBOL_H_
+#define SYMBOL_H_
+#include <stddef.h>
+/* ******************
+   External functions
+   ****************** */
+/* Every distinct identifier of a script is interned once and known by
+ * a dense id from then on, so comparing two names is comparing two
+ * integers. Ids count up from 0 in the order names are first seen,
+ * they can index arrays directly */
+typedef unsigned int Symbol;
+/* never handed out, stands for "no name" */
+#define SYMBOL_NONE ((Symbol) -1)
+
+/* returns the id of the length bytes at str, str doesn't need
+ * to be NUL terminated */
+Symbol SymbolIntern(const char *str, size_t length);
+/* the NUL terminated name, it lives until SymbolTableFree */
+const char *SymbolName(Symbol symbol);
+size_t SymbolCount(void);
+/* call this AFTER every symbol is done being used */
+void SymbolTableFree(void);
+
+/* ******************
+   Internal Functions
+   ****************** */
+#define SYMBOL_TABLE_INITIAL_CAPACITY 64 /* power of 2 */
+#define SYMBOL_NAME_BLOCK_SIZE 4096
+/* doubles the slot table and places every symbol again */
+void symbol_grow(void);
+char *symbol_copy_name(const char *str, size_t length);
+#endif
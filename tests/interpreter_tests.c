@@ -9,7 +9,6 @@
 
 #include "../ampobject.c"
 #include "../ast.c"
-#include "../dict_vars.c"
 #include "../hash.c"
 #include "../interpreter.c"
 #include "../intobject.c"
@@ -0,0 +1,504 @@
+/*
+    This file is part of Ample.
+
+    Ample is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ample is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ample.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "vm.h"
+#include "array.h"
+#include "bool.h"
+#include "bytecode.h"
+#include "hash.h"
+#include "ample_errors.h"
+#include "interpreter_functions.h"
+#include "objects/ampobject.h"
+#include "objects/boolobject.h"
+#include "objects/listobject.h"
+#include "objects/numobject.h"
+#include "objects/strobject.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+DICT_DECLARE (VMFunc, Symbol, struct BytecodeFunction *);
+DICT_IMPL (VMFunc, Symbol, struct BytecodeFunction *)
+static DICT (VMFunc) vm_func_dict;
+/* bumped whenever a function is defined, which is what
+ * invalidates the caches of the call sites */
+static unsigned int vm_function_generation;
+
+static AmpValue *vm_registers;
+static size_t vm_register_capacity;
+static struct VMFrame *vm_frames; /* array */
+static AmpValue *vm_globals;
+static size_t vm_stack_limit;
+
+#define VM_SET_REGISTER(reg, obj)                                              \
+  do {                                                                         \
+    AmpValue old_value = (reg);                                                \
+    (reg) = (obj);                                                             \
+    AmpValueDecrementRefcount(old_value);                                      \
+  } while (0)
+
+void
+VMRun (struct BytecodeFunction *program, size_t stack_limit)
+{
+  size_t global_count = ARRAY_COUNT (program->globals);
+  size_t i;
+  DictVMFunc_init (&vm_func_dict, hash_uint, uint_compare, 10);
+  /* a new call site must not look cached */
+  vm_function_generation = 1;
+  vm_stack_limit = stack_limit;
+  vm_globals = malloc (global_count * sizeof (*vm_globals));
+  for (i = 0; i < global_count; i++)
+    {
+      vm_globals[i] = AMP_VALUE_EMPTY;
+    }
+  vm_execute (program);
+  for (i = 0; i < global_count; i++)
+    {
+      VM_SET_REGISTER (vm_globals[i], AMP_VALUE_EMPTY);
+    }
+  free (vm_globals);
+  DictVMFunc_free (&vm_func_dict);
+  ARRAY_FREE (vm_frames);
+  free (vm_registers);
+  vm_frames = NULL;
+  vm_globals = NULL;
+  vm_registers = NULL;
+  vm_register_capacity = 0;
+}
+
+void
+vm_check_stack_limit (size_t register_count, size_t frame_count)
+{
+  if (register_count * sizeof (AmpValue)
+      + frame_count * sizeof (struct VMFrame)
+      > vm_stack_limit)
+    {
+      printf (ample_error_codes[ERROR_STACK_OVERFLOW],
+              (unsigned int) (vm_stack_limit >> 20));
+      exit (1);
+    }
+}
+
+void
+vm_reserve_registers (size_t count)
+{
+  size_t i;
+  if (count > vm_register_capacity)
+    {
+      size_t new_capacity = vm_register_capacity ? vm_register_capacity : 64;
+      while (new_capacity < count)
+        new_capacity *= 2;
+      if (vm_registers)
+        vm_registers = realloc (vm_registers,
+                                new_capacity * sizeof (*vm_registers));
+      else
+        vm_registers = malloc (new_capacity * sizeof (*vm_registers));
+      for (i = vm_register_capacity; i < new_capacity; i++)
+        {
+          vm_registers[i] = AMP_VALUE_EMPTY;
+        }
+      vm_register_capacity = new_capacity;
+    }
+}
+
+void
+vm_clear_registers (size_t first, size_t count)
+{
+  size_t i;
+  for (i = first; i < first + count; i++)
+    {
+      VM_SET_REGISTER (vm_registers[i], AMP_VALUE_EMPTY);
+    }
+}
+
+const char *
+vm_local_name (struct BytecodeFunction *function,
+               unsigned int reg,
+               unsigned int pc)
+{
+  size_t i;
+  for (i = 0; i < ARRAY_COUNT (function->locals); i++)
+    {
+      struct LocalVariable *local = &function->locals[i];
+      if (local->reg == reg && local->start <= pc && pc < local->end)
+        return SymbolName (local->name);
+    }
+  return "?";
+}
+
+AmpValue
+vm_binary_op (OpCode op, AmpValue left, AmpValue right)
+{
+  AmpOperations *ops;
+  if (AMP_VALUE_IS_EMPTY (left) || AMP_VALUE_IS_EMPTY (right))
+    {
+      printf ("Attempting operation on a value that does not exist\n");
+      exit (1);
+    }
+  if (AMP_VALUE_TYPE (left) != AMP_VALUE_TYPE (right))
+    {
+      if (op >= OP_EQUAL)
+        printf (ample_error_codes[ERROR_OPERATION_ON_DIFFERENT_TYPES],
+                AMP_OBJECT_TYPE_STR[AMP_VALUE_TYPE (left)],
+                AMP_OBJECT_TYPE_STR[AMP_VALUE_TYPE (right)]);
+      else
+        printf ("Attempting binary operation on values of different types\n");
+      exit (1);
+    }
+  ops = &AmpValueInfo (left)->ops;
+  switch (op)
+    {
+    case OP_ADD: return ops->add (left, right);
+    case OP_SUB: return ops->sub (left, right);
+    case OP_MUL: return ops->mult (left, right);
+    case OP_DIV: return ops->div (left, right);
+    case OP_EQUAL: return ops->equal (left, right);
+    case OP_NOT_EQUAL: return ops->not_equal (left, right);
+    case OP_LESS_THAN: return ops->less_than (left, right);
+    case OP_GREATER_THAN: return ops->greater_than (left, right);
+    default:
+      printf ("Invalid binary operation\n");
+      exit (1);
+    }
+}
+
+AmpValue
+vm_number_op (OpCode op, double left, double right)
+{
+  switch (op)
+    {
+    case OP_ADD: return AmpNumberCreate (left + right);
+    case OP_SUB: return AmpNumberCreate (left - right);
+    case OP_MUL: return AmpNumberCreate (left * right);
+    case OP_DIV: return AmpNumberCreate (left / right);
+    case OP_EQUAL: return AMP_VALUE_FROM_BOOL (AMP_NUMBER_EQUAL (left, right));
+    case OP_NOT_EQUAL:
+      return AMP_VALUE_FROM_BOOL (!AMP_NUMBER_EQUAL (left, right));
+    case OP_LESS_THAN: return AMP_VALUE_FROM_BOOL (left < right);
+    /* like amp_integer_greater_than, equal numbers count as greater */
+    case OP_GREATER_THAN: return AMP_VALUE_FROM_BOOL (!(left < right));
+    default:
+      printf ("Invalid binary operation\n");
+      exit (1);
+    }
+}
+
+void
+vm_execute (struct BytecodeFunction *program)
+{
+  struct VMFrame main_frame = { 0 };
+  struct VMFrame *frame;
+  struct BytecodeFunction *function = program;
+  Instruction *ip = program->code;
+  AmpValue *R;
+
+  main_frame.function = program;
+  ARRAY_PUSH (vm_frames, main_frame);
+  frame = &vm_frames[0];
+  vm_reserve_registers (program->register_count);
+  R = vm_registers;
+
+  for (;;)
+    {
+      Instruction ins = *ip++;
+      switch (INS_OP (ins))
+        {
+        case OP_LOAD_CONST:
+          {
+            AmpValue obj = function->constants[INS_BX (ins)];
+            AmpValueIncrementRefcount (obj);
+            VM_SET_REGISTER (R[INS_A (ins)], obj);
+          }
+          break;
+        case OP_MOVE:
+          {
+            AmpValue obj = R[INS_B (ins)];
+            AmpValueIncrementRefcount (obj);
+            VM_SET_REGISTER (R[INS_A (ins)], obj);
+          }
+          break;
+        case OP_GET_LOCAL:
+          {
+            AmpValue obj = R[INS_B (ins)];
+            if (AMP_VALUE_IS_EMPTY (obj))
+              {
+                printf ("Variable \"%s\" does not exist\n",
+                        vm_local_name (function,
+                                       INS_B (ins),
+                                       ip - 1 - function->code));
+                exit (1);
+              }
+            AmpValueIncrementRefcount (obj);
+            VM_SET_REGISTER (R[INS_A (ins)], obj);
+          }
+          break;
+        case OP_SET_LOCAL:
+        case OP_SET_GLOBAL:
+          {
+            /* the value's register is dead after an assignment,
+             * so its reference moves into the variable */
+            unsigned int value_reg;
+            AmpValue *variable;
+            if (INS_OP (ins) == OP_SET_LOCAL)
+              {
+                value_reg = INS_B (ins);
+                variable = &R[INS_A (ins)];
+              }
+            else
+              {
+                value_reg = INS_A (ins);
+                variable = &vm_globals[INS_BX (ins)];
+              }
+            if (AMP_VALUE_IS_EMPTY (R[value_reg]))
+              {
+                printf ("Variable \"%s\" is assigned a value that does "
+                        "not exist\n",
+                        INS_OP (ins) == OP_SET_LOCAL
+                          ? vm_local_name (function,
+                                           INS_A (ins),
+                                           ip - 1 - function->code)
+                          : SymbolName (function->globals[INS_BX (ins)]));
+                exit (1);
+              }
+            VM_SET_REGISTER (*variable, R[value_reg]);
+            R[value_reg] = AMP_VALUE_EMPTY;
+          }
+          break;
+        case OP_GET_GLOBAL:
+          {
+            AmpValue obj = vm_globals[INS_BX (ins)];
+            if (AMP_VALUE_IS_EMPTY (obj))
+              {
+                printf ("Variable \"%s\" does not exist\n",
+                        SymbolName (function->globals[INS_BX (ins)]));
+                exit (1);
+              }
+            AmpValueIncrementRefcount (obj);
+            VM_SET_REGISTER (R[INS_A (ins)], obj);
+          }
+          break;
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_EQUAL:
+        case OP_NOT_EQUAL:
+        case OP_LESS_THAN:
+        case OP_GREATER_THAN:
+          {
+            AmpValue left = R[INS_B (ins)];
+            AmpValue right = R[INS_C (ins)];
+            AmpValue obj;
+            if (AMP_VALUE_IS_NUMBER (left) && AMP_VALUE_IS_NUMBER (right))
+              obj = vm_number_op (INS_OP (ins),
+                                  AMP_VALUE_TO_NUMBER (left),
+                                  AMP_VALUE_TO_NUMBER (right));
+            else if (INS_OP (ins) == OP_ADD && INS_A (ins) == INS_B (ins)
+                     && AMP_STRING_IS_UNSHARED (left)
+                     && AMP_VALUE_TYPE (right) == AMP_OBJECT_STRING
+                     && left != right)
+              {
+                /* the string would die when R(A) is overwritten,
+                 * so the result is built in it instead */
+                R[INS_A (ins)] = AmpStringAppend (left, right);
+                break;
+              }
+            else
+              obj = vm_binary_op (INS_OP (ins), left, right);
+            VM_SET_REGISTER (R[INS_A (ins)], obj);
+          }
+          break;
+        case OP_LIST:
+        case OP_APPEND:
+          {
+            AmpValue *array = NULL;
+            unsigned int first = INS_B (ins);
+            unsigned int i;
+            if (INS_OP (ins) == OP_APPEND)
+              array = AMP_LIST (R[INS_A (ins)])->array;
+            for (i = first; i < first + INS_C (ins); i++)
+              {
+                AmpValueIncrementRefcount (R[i]);
+                ARRAY_PUSH (array, R[i]);
+              }
+            if (INS_OP (ins) == OP_APPEND)
+              AMP_LIST (R[INS_A (ins)])->array = array;
+            else
+              VM_SET_REGISTER (R[INS_A (ins)], AmpListCreate (array));
+          }
+          break;
+        case OP_TEST:
+          {
+            AmpValue obj = R[INS_A (ins)];
+            if (!AMP_VALUE_IS_BOOL (obj))
+              {
+                printf ("Expression does not evaluate to a bool\n");
+                exit (1);
+              }
+            if (AMP_VALUE_TO_BOOL (obj))
+              ip++;
+          }
+          break;
+        case OP_JUMP:
+          ip += INS_SAX (ins);
+          break;
+        case OP_ENTER_SCOPE:
+        case OP_LEAVE_SCOPE:
+          vm_clear_registers (frame->base + INS_A (ins), INS_B (ins));
+          break;
+        case OP_FUNC:
+          {
+            struct BytecodeFunction *f = function->functions[INS_BX (ins)];
+            DictVMFunc_insert (&vm_func_dict, f->name, f);
+            vm_function_generation++;
+          }
+          break;
+        case OP_CALL:
+        case OP_TAIL_CALL:
+          {
+            struct CallSite *site = &function->call_sites[INS_BX (ins)];
+            AmpValue *args = &R[INS_A (ins)];
+            struct BytecodeFunction *callee;
+
+            /* the cached callee is good until the next function
+             * definition */
+            if (site->generation != vm_function_generation)
+              {
+                if (!DictVMFunc_get (&vm_func_dict,
+                                     function->names[site->name],
+                                     &callee))
+                  callee = NULL;
+                site->cached_callee = callee;
+                site->generation = vm_function_generation;
+              }
+            callee = site->cached_callee;
+            if (callee)
+              {
+                struct VMFrame new_frame;
+                size_t param_count = ARRAY_COUNT (callee->params);
+                size_t i;
+                if (param_count != site->arg_count)
+                  {
+                    printf ("Invalid number of arguments for function "
+                            "\"%s\",",
+                            SymbolName (function->names[site->name]));
+                    printf ("expected %u arguments and %u were provided\n",
+                            (unsigned int) param_count,
+                            (unsigned int) site->arg_count);
+                    exit (1);
+                  }
+                if (INS_OP (ins) == OP_TAIL_CALL)
+                  {
+                    /* the callee runs in the frame of the caller, which
+                     * only has to keep the arguments, as R(0)... */
+                    vm_clear_registers (frame->base, INS_A (ins));
+                    for (i = 0; i < param_count && INS_A (ins) != 0; i++)
+                      {
+                        R[i] = R[INS_A (ins) + i];
+                        R[INS_A (ins) + i] = AMP_VALUE_EMPTY;
+                      }
+                    vm_clear_registers (frame->base + param_count,
+                                        function->register_count
+                                          - param_count);
+                    if (site->tail == CALL_TAIL_STATEMENT)
+                      frame->drop_result = true;
+                    frame->function = callee;
+                    vm_check_stack_limit (frame->base
+                                            + callee->register_count,
+                                          ARRAY_COUNT (vm_frames));
+                    vm_reserve_registers (frame->base
+                                          + callee->register_count);
+                    vm_clear_registers (frame->base + param_count,
+                                        callee->local_count - param_count);
+                    function = callee;
+                    ip = callee->code;
+                    R = vm_registers + frame->base;
+                    break;
+                  }
+                /* the arguments are already in place as
+                 * the first variables of the new frame */
+                frame->ip = ip;
+                new_frame.function = callee;
+                new_frame.ip = callee->code;
+                new_frame.base = frame->base + INS_A (ins);
+                new_frame.return_register = new_frame.base;
+                new_frame.drop_result = false;
+                vm_check_stack_limit (new_frame.base + callee->register_count,
+                                      ARRAY_COUNT (vm_frames) + 1);
+                ARRAY_PUSH (vm_frames, new_frame);
+                frame = &vm_frames[ARRAY_COUNT (vm_frames) - 1];
+
+                vm_reserve_registers (frame->base + callee->register_count);
+                /* the rest of its variables start out unassigned */
+                vm_clear_registers (frame->base + param_count,
+                                    callee->local_count - param_count);
+                function = callee;
+                ip = frame->ip;
+                R = vm_registers + frame->base;
+              }
+            else
+              {
+                AmpValue obj;
+                /* a return that is a statement was compiled
+                 * into OP_RETURN */
+                if (site->builtin == AMPLE_BUILTIN_NONE
+                    || site->builtin == AMPLE_BUILTIN_RETURN)
+                  {
+                    printf ("Function does not exist: %s\n",
+                            SymbolName (function->names[site->name]));
+                    exit (1);
+                  }
+                obj = AmpleBuiltinCall (site->builtin, args, site->arg_count);
+                VM_SET_REGISTER (R[INS_A (ins)], obj);
+              }
+          }
+          break;
+        case OP_RETURN:
+          {
+            AmpValue ret = AMP_VALUE_EMPTY;
+            size_t return_register = frame->return_register;
+            if (INS_B (ins))
+              {
+                ret = R[INS_A (ins)];
+                R[INS_A (ins)] = AMP_VALUE_EMPTY;
+              }
+            if (frame->drop_result)
+              {
+                AmpValueDecrementRefcount (ret);
+                ret = AMP_VALUE_EMPTY;
+              }
+            vm_clear_registers (frame->base, function->register_count);
+            ARRAY_POP (vm_frames);
+
+            if (ARRAY_COUNT (vm_frames) == 0)
+              {
+                /* returned from the global scope */
+                AmpValueDecrementRefcount (ret);
+                return;
+              }
+            frame = &vm_frames[ARRAY_COUNT (vm_frames) - 1];
+            function = frame->function;
+            ip = frame->ip;
+            R = vm_registers + frame->base;
+            VM_SET_REGISTER (vm_registers[return_register], ret);
+          }
+          break;
+        default:
+          printf ("Invalid instruction %u\n", (unsigned int) INS_OP (ins));
+          exit (1);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+/*
+    This file is part of Ample.
+
+    Ample is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Ample is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Ample.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef VM_H_
+#define VM_H_
+#include "bytecode.h"
+/* ******************
+   External functions
+   ****************** */
+/* runs a program produced by CompileProgram, the frames and registers
+ * of the running calls may take up to stack_limit bytes */
+void VMRun(struct BytecodeFunction *program, size_t stack_limit);
+
+/* ******************
+   Internal Functions
+   ****************** */
+/* One activation of a function. Ample calls never recurse on the C stack,
+ * every frame lives in a heap array and indexes into a shared
+ * register array */
+struct VMFrame {
+  struct BytecodeFunction *function;
+  Instruction *ip;
+  size_t base;            /* index of R(0) in the register array */
+  size_t return_register; /* absolute index the return value goes to */
+  /* a statement made a tail call in it, so whatever the function
+   * returns the caller gets nothing */
+  bool32 drop_result;
+};
+
+void vm_execute(struct BytecodeFunction *program);
+/* stops the program if register_count registers and frame_count frames
+ * would take up more than the stack limit, checked before either is
+ * allocated */
+void vm_check_stack_limit(size_t register_count, size_t frame_count);
+/* makes sure registers [0, count) can be indexed */
+void vm_reserve_registers(size_t count);
+void vm_clear_registers(size_t first, size_t count);
+/* the name of the variable held by register reg at instruction pc */
+const char *vm_local_name(struct BytecodeFunction *function,
+                          unsigned int reg,
+                          unsigned int pc);
+AmpValue vm_binary_op(OpCode op, AmpValue left, AmpValue right);
+/* the operation on two numbers, which needs neither the operation
+ * table nor refcounting */
+AmpValue vm_number_op(OpCode op, double left, double right);
+#endif